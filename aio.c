@@ -0,0 +1,276 @@
+/*
+*  aio.c - Interface assincrona para o sistema de arquivos virtual (vfs)
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*/
+
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <pthread.h>
+#include "aio.h"
+
+#define AIO_DEFAULT_THREADS 4
+
+//Operacoes dos pedidos
+#define AIO_OP_OPEN 1
+#define AIO_OP_READ 2
+#define AIO_OP_WRITE 3
+#define AIO_OP_CLOSE 4
+
+//Estados dos pedidos
+#define AIO_FREE 0	//Posicao livre
+#define AIO_QUEUED 1	//Na fila de envio
+#define AIO_RUNNING 2	//Em execucao por uma thread do pool
+#define AIO_DONE 3	//Na fila de concluidos
+
+typedef struct aio_request {
+	int handle;		//Identificador: posicao + 1 mais um multiplo de AIO_MAX_REQUESTS
+	int state;
+	int op;
+	int fd;
+	char *path;		//Copia do caminho de aioOpen, liberada na execucao
+	char *buf;
+	unsigned int nbytes;
+	unsigned int offset;
+	AioCallback cb;
+	void *arg;
+	int result;
+	int next;		//Proximo pedido da fila (-1 no fim)
+} AioRequest;
+
+//Fila de pedidos, encadeada pelas posicoes
+typedef struct aio_queue {
+	int head;
+	int tail;
+} AioQueue;
+
+AioRequest aioRequests[AIO_MAX_REQUESTS];
+AioQueue aioSubmitted = { -1, -1 };
+AioQueue aioCompleted = { -1, -1 };
+unsigned int aioWaiting; //Pedidos sem callback ainda nao concluidos
+pthread_t aioThreads[AIO_MAX_THREADS];
+unsigned int aioNumThreads; //0: pool parado
+int aioStop;
+pthread_mutex_t aioLock = PTHREAD_MUTEX_INITIALIZER; //Protege todo o estado acima
+pthread_cond_t aioWork = PTHREAD_COND_INITIALIZER; //Sinalizada a cada pedido enviado
+pthread_cond_t aioDone = PTHREAD_COND_INITIALIZER; //Sinalizada a cada pedido concluido
+
+//Funcao interna que poe o pedido r no fim da fila q
+void _aioPush (AioQueue *q, int r) {
+	aioRequests[r].next = -1;
+	if ( q->tail == -1 ) q->head = r;
+	else aioRequests[q->tail].next = r;
+	q->tail = r;
+}
+
+//Funcao interna que retira o pedido r da fila q, onde ele deve estar
+void _aioRemove (AioQueue *q, int r) {
+	int prev = -1;
+	for (int i = q->head; i != r; i = aioRequests[i].next) prev = i;
+	if ( prev == -1 ) q->head = aioRequests[r].next;
+	else aioRequests[prev].next = aioRequests[r].next;
+	if ( q->tail == r ) q->tail = prev;
+}
+
+//Funcao interna que libera a posicao do pedido r
+void _aioFree (int r) {
+	aioRequests[r].state = AIO_FREE;
+}
+
+//Funcao interna que executa o pedido r na funcao correspondente do vfs
+int _aioExecute (AioRequest *r) {
+	switch ( r->op ) {
+		case AIO_OP_OPEN: return vfsOpen (r->path);
+		case AIO_OP_READ: return vfsPread (r->fd, r->buf, r->nbytes, r->offset);
+		case AIO_OP_WRITE: return vfsPwrite (r->fd, r->buf, r->nbytes, r->offset);
+		case AIO_OP_CLOSE: return vfsClose (r->fd);
+	}
+	return -1;
+}
+
+//Funcao interna executada pelas threads do pool: retira os pedidos da fila
+//de envio ate o pool ser terminado e a fila esvaziar
+void* _aioWorker (void *unused) {
+	(void) unused;
+	pthread_mutex_lock (&aioLock);
+	while ( 1 ) {
+		while ( aioSubmitted.head == -1 && !aioStop )
+			pthread_cond_wait (&aioWork, &aioLock);
+		int i = aioSubmitted.head;
+		if ( i == -1 ) break;
+		_aioRemove (&aioSubmitted, i);
+		AioRequest *r = &aioRequests[i];
+		r->state = AIO_RUNNING;
+
+		pthread_mutex_unlock (&aioLock);
+		int result = _aioExecute (r);
+		free (r->path);
+		r->path = NULL;
+		if ( r->cb ) r->cb (r->handle, result, r->arg);
+		pthread_mutex_lock (&aioLock);
+
+		if ( r->cb ) _aioFree (i);
+		else {
+			r->result = result;
+			r->state = AIO_DONE;
+			_aioPush (&aioCompleted, i);
+			aioWaiting--;
+			pthread_cond_broadcast (&aioDone);
+		}
+	}
+	pthread_mutex_unlock (&aioLock);
+	return NULL;
+}
+
+//Funcao interna que envia um pedido. Retorna o identificador ou -1
+int _aioSubmit (int op, int fd, const char *path, char *buf, unsigned int nbytes,
+		unsigned int offset, AioCallback cb, void *arg) {
+	int ret = -1;
+	char *copy = NULL;
+	if ( path && (copy = strdup (path)) == NULL ) return -1;
+
+	pthread_mutex_lock (&aioLock);
+	for (int i = 0; i < AIO_MAX_REQUESTS && aioNumThreads && !aioStop; i++) {
+		AioRequest *r = &aioRequests[i];
+		if ( r->state != AIO_FREE ) continue;
+
+		//o identificador muda a cada uso da posicao
+		r->handle = r->handle > 0 && r->handle <= INT_MAX - AIO_MAX_REQUESTS ?
+			r->handle + AIO_MAX_REQUESTS : i + 1;
+		r->state = AIO_QUEUED;
+		r->op = op;
+		r->fd = fd;
+		r->path = copy;
+		r->buf = buf;
+		r->nbytes = nbytes;
+		r->offset = offset;
+		r->cb = cb;
+		r->arg = arg;
+		if ( !cb ) aioWaiting++;
+		_aioPush (&aioSubmitted, i);
+		pthread_cond_signal (&aioWork);
+		ret = r->handle;
+		copy = NULL;
+		break;
+	}
+	pthread_mutex_unlock (&aioLock);
+	free (copy);
+	return ret;
+}
+
+//Funcao que inicia o pool com numThreads threads (0 para o padrao).
+//Retorna 0 caso bem sucedido e -1 em contrario
+int aioInit (unsigned int numThreads) {
+	if ( !numThreads ) numThreads = AIO_DEFAULT_THREADS;
+	if ( numThreads > AIO_MAX_THREADS ) numThreads = AIO_MAX_THREADS;
+
+	pthread_mutex_lock (&aioLock);
+	if ( aioNumThreads ) {
+		pthread_mutex_unlock (&aioLock);
+		return -1;
+	}
+	aioStop = 0;
+	while ( aioNumThreads < numThreads &&
+		pthread_create (&aioThreads[aioNumThreads], NULL, _aioWorker, NULL) == 0 )
+		aioNumThreads++;
+	pthread_mutex_unlock (&aioLock);
+	if ( aioNumThreads ) return 0;
+	return -1;
+}
+
+//Funcao que termina o pool, esperando os pedidos ja enviados. Os pedidos
+//concluidos e nao consultados sao descartados
+void aioShutdown (void) {
+	pthread_mutex_lock (&aioLock);
+	unsigned int n = aioNumThreads;
+	aioStop = 1;
+	pthread_cond_broadcast (&aioWork);
+	pthread_mutex_unlock (&aioLock);
+
+	for (unsigned int i = 0; i < n; i++)
+		pthread_join (aioThreads[i], NULL);
+
+	pthread_mutex_lock (&aioLock);
+	for (int i = 0; i < AIO_MAX_REQUESTS; i++)
+		_aioFree (i);
+	aioCompleted.head = aioCompleted.tail = -1;
+	aioWaiting = 0;
+	aioNumThreads = 0;
+	pthread_cond_broadcast (&aioDone);
+	pthread_mutex_unlock (&aioLock);
+}
+
+//Funcao que envia um vfsOpen do caminho path. Retorna o identificador do
+//pedido ou -1
+int aioOpen (const char *path, AioCallback cb, void *arg) {
+	if ( !path ) return -1;
+	return _aioSubmit (AIO_OP_OPEN, -1, path, NULL, 0, 0, cb, arg);
+}
+
+//Funcao que envia um vfsPread de nbytes bytes do descritor fd, a partir da
+//posicao offset. Retorna o identificador do pedido ou -1
+int aioRead (int fd, char *buf, unsigned int nbytes, unsigned int offset, AioCallback cb, void *arg) {
+	if ( !buf ) return -1;
+	return _aioSubmit (AIO_OP_READ, fd, NULL, buf, nbytes, offset, cb, arg);
+}
+
+//Funcao que envia um vfsPwrite de nbytes bytes no descritor fd, a partir
+//da posicao offset. Retorna o identificador do pedido ou -1
+int aioWrite (int fd, const char *buf, unsigned int nbytes, unsigned int offset, AioCallback cb, void *arg) {
+	if ( !buf ) return -1;
+	return _aioSubmit (AIO_OP_WRITE, fd, NULL, (char*) buf, nbytes, offset, cb, arg);
+}
+
+//Funcao que envia um vfsClose do descritor fd. Retorna o identificador do
+//pedido ou -1
+int aioClose (int fd, AioCallback cb, void *arg) {
+	return _aioSubmit (AIO_OP_CLOSE, fd, NULL, NULL, 0, 0, cb, arg);
+}
+
+//Funcao que retira da fila o pedido concluido mais antigo e o copia para
+//c. Com block, espera enquanto houver pedidos em andamento. Retorna 1 se
+//um pedido foi retirado ou 0
+int aioPoll (AioCompletion *c, int block) {
+	int ret = 0;
+	if ( !c ) return 0;
+	pthread_mutex_lock (&aioLock);
+	while ( block && aioCompleted.head == -1 && aioWaiting )
+		pthread_cond_wait (&aioDone, &aioLock);
+	int i = aioCompleted.head;
+	if ( i != -1 ) {
+		_aioRemove (&aioCompleted, i);
+		c->handle = aioRequests[i].handle;
+		c->result = aioRequests[i].result;
+		c->arg = aioRequests[i].arg;
+		_aioFree (i);
+		ret = 1;
+	}
+	pthread_mutex_unlock (&aioLock);
+	return ret;
+}
+
+//Funcao que espera a conclusao do pedido handle e o retira da fila. Se
+//result nao for NULL, recebe o resultado. Retorna 0 ou -1
+int aioWait (int handle, int *result) {
+	int ret = -1;
+	if ( handle < 1 ) return -1;
+	int i = (handle - 1) % AIO_MAX_REQUESTS;
+	AioRequest *r = &aioRequests[i];
+
+	pthread_mutex_lock (&aioLock);
+	while ( r->handle == handle && !r->cb && (r->state == AIO_QUEUED || r->state == AIO_RUNNING) )
+		pthread_cond_wait (&aioDone, &aioLock);
+	if ( r->handle == handle && r->state == AIO_DONE ) {
+		_aioRemove (&aioCompleted, i);
+		if ( result ) *result = r->result;
+		_aioFree (i);
+		ret = 0;
+	}
+	pthread_mutex_unlock (&aioLock);
+	return ret;
+}
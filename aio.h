@@ -0,0 +1,70 @@
+/*
+*  aio.h - Interface assincrona para o sistema de arquivos virtual (vfs)
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*  Cada pedido e' executado por uma das threads de um conjunto (pool), que
+*  chama a funcao correspondente do vfs. A chamada retorna logo um
+*  identificador do pedido; o resultado e' entregue a uma funcao de retorno
+*  (callback), executada na thread do pool, ou fica em uma fila de pedidos
+*  concluidos, consultada por aioPoll ou aioWait.
+*
+*/
+
+#ifndef AIO_H
+#define AIO_H
+
+#include "vfs.h"
+
+//Quantidade maxima de pedidos em andamento ou concluidos e nao consultados
+#define AIO_MAX_REQUESTS 64
+
+//Quantidade maxima de threads do pool
+#define AIO_MAX_THREADS 16
+
+//Funcao de retorno de um pedido concluido: recebe o identificador do
+//pedido, o resultado da funcao do vfs e o argumento dado no pedido
+typedef void (*AioCallback) (int handle, int result, void *arg);
+
+//Pedido concluido retirado da fila por aioPoll
+typedef struct aio_completion {
+	int handle;	//Identificador do pedido
+	int result;	//Resultado da funcao do vfs
+	void *arg;	//Argumento dado no pedido
+} AioCompletion;
+
+//Funcao que inicia o pool com numThreads threads (0 para o padrao).
+//Retorna 0 caso bem sucedido e -1 em contrario
+int aioInit (unsigned int numThreads);
+
+//Funcao que termina o pool, esperando os pedidos ja enviados. Os pedidos
+//concluidos e nao consultados sao descartados
+void aioShutdown (void);
+
+//Funcoes que enviam, respectivamente, um vfsOpen, um vfsPread, um vfsPwrite
+//e um vfsClose. A leitura e a escrita usam a posicao offset, e nao o
+//cursor, ja' que pedidos do mesmo descritor podem ser executados em
+//qualquer ordem. O caminho de aioOpen e' copiado no envio; os buffers de
+//aioRead e aioWrite devem continuar validos ate a conclusao, e o descritor
+//nao deve ser fechado com pedidos pendentes. Com cb NULL, o resultado fica
+//na fila de concluidos. Retornam o identificador do pedido ou -1 se o pool
+//nao foi iniciado ou nao houver pedidos livres
+int aioOpen (const char *path, AioCallback cb, void *arg);
+int aioRead (int fd, char *buf, unsigned int nbytes, unsigned int offset, AioCallback cb, void *arg);
+int aioWrite (int fd, const char *buf, unsigned int nbytes, unsigned int offset, AioCallback cb, void *arg);
+int aioClose (int fd, AioCallback cb, void *arg);
+
+//Funcao que retira da fila o pedido concluido mais antigo (enviado sem
+//callback) e o copia para c. Com block diferente de 0, espera enquanto
+//houver pedidos em andamento. Retorna 1 se um pedido foi retirado ou 0
+int aioPoll (AioCompletion *c, int block);
+
+//Funcao que espera a conclusao do pedido handle (enviado sem callback) e
+//o retira da fila. Se result nao for NULL, recebe o resultado. Retorna 0
+//caso bem sucedido e -1 em contrario
+int aioWait (int handle, int *result);
+
+#endif
@@ -0,0 +1,152 @@
+/*
+*  dcache.c - Cache de entradas de diretorio (dentry cache) do MyFS
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "dcache.h"
+
+#define DCACHE_NUM_BUCKETS 1024 //deve ser potencia de 2
+
+//Entrada da cache: mapeia (diretorio pai, nome) para o i-node filho.
+//As entradas ficam encadeadas no balde da tabela hash e em uma lista LRU
+typedef struct dentry {
+	unsigned int parent;
+	unsigned int child; //0 para busca negativa
+	char* name;
+	struct dentry* hashNext;
+	struct dentry* lruPrev;
+	struct dentry* lruNext;
+} Dentry;
+
+Dentry* dcacheBuckets[DCACHE_NUM_BUCKETS];
+Dentry* dcacheLruHead; //usada mais recentemente
+Dentry* dcacheLruTail; //usada menos recentemente
+unsigned int dcacheCount;
+
+//função que calcula o balde de um par (parent, name) (FNV-1a)
+unsigned int _dcacheHash(unsigned int parent, const char* name)
+{
+	unsigned int h = 2166136261u ^ parent;
+	for(; *name; name++) {
+		h ^= (unsigned char) *name;
+		h *= 16777619u;
+	}
+	return h & (DCACHE_NUM_BUCKETS - 1);
+}
+
+//função que retira uma entrada da lista LRU
+void _dcacheLruUnlink(Dentry* e)
+{
+	if(e->lruPrev) e->lruPrev->lruNext = e->lruNext;
+	else dcacheLruHead = e->lruNext;
+	if(e->lruNext) e->lruNext->lruPrev = e->lruPrev;
+	else dcacheLruTail = e->lruPrev;
+	e->lruPrev = e->lruNext = NULL;
+}
+
+//função que coloca uma entrada no inicio da lista LRU
+void _dcacheLruPush(Dentry* e)
+{
+	e->lruPrev = NULL;
+	e->lruNext = dcacheLruHead;
+	if(dcacheLruHead) dcacheLruHead->lruPrev = e;
+	dcacheLruHead = e;
+	if(!dcacheLruTail) dcacheLruTail = e;
+}
+
+//função que retorna a entrada do par (parent, name) ou NULL.
+//Se prev nao for NULL, recebe a entrada anterior no balde
+Dentry* _dcacheFind(unsigned int parent, const char* name, Dentry** prev)
+{
+	Dentry* p = NULL;
+	for(Dentry* e = dcacheBuckets[_dcacheHash(parent, name)]; e != NULL; e = e->hashNext) {
+		if(e->parent == parent && !strcmp(e->name, name)) {
+			if(prev) *prev = p;
+			return e;
+		}
+		p = e;
+	}
+	return NULL;
+}
+
+//função que remove e libera uma entrada da cache
+void _dcacheRemove(Dentry* e)
+{
+	Dentry* prev = NULL;
+	unsigned int b = _dcacheHash(e->parent, e->name);
+	_dcacheFind(e->parent, e->name, &prev);
+	if(prev) prev->hashNext = e->hashNext;
+	else dcacheBuckets[b] = e->hashNext;
+	_dcacheLruUnlink(e);
+	free(e->name);
+	free(e);
+	dcacheCount--;
+}
+
+//Funcao que inicializa (ou reinicializa) a cache, descartando todas as
+//entradas existentes
+void dcacheInit(void)
+{
+	while(dcacheLruHead) _dcacheRemove(dcacheLruHead);
+	for(int i = 0; i < DCACHE_NUM_BUCKETS; i++) dcacheBuckets[i] = NULL;
+	dcacheCount = 0;
+}
+
+//Funcao que procura o par (parent, name) na cache. Retorna 0 se encontrado,
+//escrevendo em *child o numero do i-node correspondente (0 indica uma busca
+//negativa). Retorna -1 se o par nao estiver na cache
+int dcacheLookup(unsigned int parent, const char* name, unsigned int* child)
+{
+	Dentry* e = _dcacheFind(parent, name, NULL);
+	if(e == NULL) return -1;
+	_dcacheLruUnlink(e);
+	_dcacheLruPush(e);
+	*child = e->child;
+	return 0;
+}
+
+//Funcao que insere ou atualiza o par (parent, name) na cache, apontando para
+//o i-node child. Um child igual a 0 registra uma busca negativa
+void dcacheInsert(unsigned int parent, const char* name, unsigned int child)
+{
+	Dentry* e = _dcacheFind(parent, name, NULL);
+	if(e != NULL) {
+		e->child = child;
+		_dcacheLruUnlink(e);
+		_dcacheLruPush(e);
+		return;
+	}
+
+	if(dcacheCount >= DCACHE_MAX_ENTRIES) _dcacheRemove(dcacheLruTail);
+
+	e = malloc(sizeof(Dentry));
+	if(e == NULL) return;
+	e->name = malloc(strlen(name) + 1);
+	if(e->name == NULL) {
+		free(e);
+		return;
+	}
+	strcpy(e->name, name);
+	e->parent = parent;
+	e->child = child;
+
+	unsigned int b = _dcacheHash(parent, name);
+	e->hashNext = dcacheBuckets[b];
+	dcacheBuckets[b] = e;
+	_dcacheLruPush(e);
+	dcacheCount++;
+}
+
+//Funcao que remove o par (parent, name) da cache, se existir
+void dcacheInvalidate(unsigned int parent, const char* name)
+{
+	Dentry* e = _dcacheFind(parent, name, NULL);
+	if(e != NULL) _dcacheRemove(e);
+}
@@ -0,0 +1,35 @@
+/*
+*  dcache.h - Cache de entradas de diretorio (dentry cache) do MyFS
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*/
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+//Numero maximo de entradas mantidas na cache. Ao atingir o limite, a
+//entrada usada ha mais tempo e' descartada
+#define DCACHE_MAX_ENTRIES 4096
+
+//Funcao que inicializa (ou reinicializa) a cache, descartando todas as
+//entradas existentes
+void dcacheInit ( void );
+
+//Funcao que procura o par (parent, name) na cache. Retorna 0 se encontrado,
+//escrevendo em *child o numero do i-node correspondente (0 indica uma busca
+//negativa, ou seja, sabe-se que o nome nao existe no diretorio). Retorna -1
+//se o par nao estiver na cache
+int dcacheLookup (unsigned int parent, const char *name, unsigned int *child);
+
+//Funcao que insere ou atualiza o par (parent, name) na cache, apontando para
+//o i-node child. Um child igual a 0 registra uma busca negativa
+void dcacheInsert (unsigned int parent, const char *name, unsigned int child);
+
+//Funcao que remove o par (parent, name) da cache, se existir
+void dcacheInvalidate (unsigned int parent, const char *name);
+
+#endif
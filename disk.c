@@ -6,12 +6,14 @@
 *  Organizacao: Universidade Federal de Juiz de Fora
 *  Departamento: Dep. Ciencia da Computacao
 *
-*  => NAO MODIFIQUE ESTE ARQUIVO <=
+*  Estendido no projeto: acesso por varias threads e descarte de setores.
 *
 */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
 #include "disk.h"
 
 #define DISK_SEEKDELAY 10
@@ -23,6 +25,11 @@
 #define DISK_SECTORPREAMBLE " [["
 #define DISK_SECTORECC "]] "
 
+//Mapa de setores descartados, gravado depois do ultimo setor: um bit por
+//setor seguido de DISK_DISCARDMAGIC e do numero de setores, em hexadecimal
+#define DISK_DISCARDMAGIC "[[TRIM]]"
+#define DISK_DISCARDTRAILER 16
+
 //Estrutura para a representação de um disco fisico.
 //Seus membros etao protegidos, portanto use o tipo Disk e as funcoes externalizadas por disk.h.
 struct disk {
@@ -32,6 +39,8 @@ struct disk {
 	unsigned long numSectors;	//Numero de setores
 	unsigned long size;		//Espaco util total para dados no disco
 	unsigned long currCylinder;	//Cilindro atual 
+	unsigned char* discarded;	//Setores descartados, um bit por setor (NULL: nenhum); copia do mapa no arquivo
+	pthread_mutex_t lock;		//Serializa o acesso de varias threads 'a cabeca e ao arquivo
 };
 
 
@@ -55,6 +64,43 @@ void __diskSeek(Disk *d, unsigned long addr) {
 	d->currCylinder = reqCyl;
 }
 
+//Funcao interna, privada, que grava no arquivo do disco os bytes first a
+//last do mapa de setores descartados, sem deslocamento da cabeca. Com
+//trailer diferente de 0, grava tambem o final do mapa. Retorna 0 ou -1
+int __diskSaveDiscarded(Disk *d, unsigned long first, unsigned long last, int trailer) {
+	char end[DISK_DISCARDTRAILER + 1];
+	fseek (d->fp, d->numSectors * DISK_SECTORTOTALSIZE + first, SEEK_SET);
+	if (fwrite (&d->discarded[first], 1, last - first + 1, d->fp) != last - first + 1)
+		return -1;
+	if (!trailer) return 0;
+	snprintf (end, sizeof (end), "%s%08lx", DISK_DISCARDMAGIC, d->numSectors);
+	fseek (d->fp, d->numSectors * DISK_SECTORTOTALSIZE + (d->numSectors + 7) / 8, SEEK_SET);
+	return fwrite (end, 1, DISK_DISCARDTRAILER, d->fp) == DISK_DISCARDTRAILER ? 0 : -1;
+}
+
+//Funcao interna, privada, que le o mapa de setores descartados gravado no
+//fim do arquivo do disco, se houver, corrigindo o numero de setores
+void __diskLoadDiscarded(Disk *d, unsigned long fileSize) {
+	char end[DISK_DISCARDTRAILER + 1] = {0};
+	unsigned long n;
+	if (fileSize < DISK_DISCARDTRAILER) return;
+	fseek (d->fp, fileSize - DISK_DISCARDTRAILER, SEEK_SET);
+	if (fread (end, 1, DISK_DISCARDTRAILER, d->fp) != DISK_DISCARDTRAILER) return;
+	if (strncmp (end, DISK_DISCARDMAGIC, strlen (DISK_DISCARDMAGIC))) return;
+	if (sscanf (&end[strlen (DISK_DISCARDMAGIC)], "%8lx", &n) != 1) return;
+	if (n * DISK_SECTORTOTALSIZE + (n + 7) / 8 + DISK_DISCARDTRAILER != fileSize) return;
+
+	d->discarded = malloc ((n + 7) / 8);
+	if (d->discarded == NULL) return;
+	fseek (d->fp, n * DISK_SECTORTOTALSIZE, SEEK_SET);
+	if (fread (d->discarded, 1, (n + 7) / 8, d->fp) != (n + 7) / 8) {
+		free (d->discarded);
+		d->discarded = NULL;
+		return;
+	}
+	d->numSectors = n;
+}
+
 //Funcao que conecta um disco fisico ao sistema operacional.
 //Um disco fisico eh implementado por meio de um arquivo regular, 
 //cujo caminho eh dado por rawDiskPath.
@@ -69,10 +115,14 @@ Disk* diskConnect(int id, char* rawDiskPath) {
 		d->id = id;
 		d->fp = fp;
 		fseek (fp, 0, SEEK_END);
-		d->numSectors = ftell (fp) / DISK_SECTORTOTALSIZE;
+		unsigned long fileSize = ftell (fp);
+		d->numSectors = fileSize / DISK_SECTORTOTALSIZE;
+		d->discarded = NULL;
+		__diskLoadDiscarded (d, fileSize);
 		d->numCylinders = d->numSectors / DISK_SECTORSPERTRACK;
 		d->size = d->numSectors * DISK_SECTORDATASIZE;
 		d->currCylinder = 0;
+		pthread_mutex_init (&d->lock, NULL);
 	}
 	return d;
 }
@@ -80,6 +130,8 @@ Disk* diskConnect(int id, char* rawDiskPath) {
 //Funcao que disconecta um disco fisico do sistema operacional
 int diskDisconnect(Disk* d) {
 	int result = fclose (d->fp);
+	pthread_mutex_destroy (&d->lock);
+	free(d->discarded);
 	free(d);
 	return result;
 }
@@ -124,22 +176,68 @@ int diskAddrToCylinder (Disk* d, unsigned long addr, unsigned long *cyl) {
 //(addr). Os dados sao transferidos para *data. Retorna 0 se a leitura ocorreu
 //sem erros e -1 caso contrario
 int diskReadSector (Disk* d, unsigned long addr, unsigned char *data) {
+	int result = 0;
 	if (addr >= d->numSectors) return -1;
-	__diskSeek (d,addr);
-	if (fread (data, 1, DISK_SECTORDATASIZE, d->fp) != DISK_SECTORDATASIZE)
-		return -1;
-	return 0;
+	pthread_mutex_lock (&d->lock);
+	if (d->discarded && (d->discarded[addr/8] & (1 << addr%8)))
+		memset (data, 0, DISK_SECTORDATASIZE);
+	else {
+		__diskSeek (d,addr);
+		if (fread (data, 1, DISK_SECTORDATASIZE, d->fp) != DISK_SECTORDATASIZE)
+			result = -1;
+	}
+	pthread_mutex_unlock (&d->lock);
+	return result;
 }
 
 //Funcao para realzar a escrita de um setor identificado pelo endereco LBA
 //(addr). Os dados sao transferidos a partir de *data. Retorna 0 se a leitura
 //ocorreu sem erros e -1 caso contrario
 int diskWriteSector (Disk* d, unsigned long addr, unsigned char* data) {
+	int result = 0;
 	if (addr >= d->numSectors) return -1;
-	__diskSeek (d,addr);
-	if (fwrite (data, 1, DISK_SECTORDATASIZE, d->fp) != DISK_SECTORDATASIZE)
-		return -1;
-	return 0;
+	pthread_mutex_lock (&d->lock);
+	//o setor deixa de ser descartado no mapa antes de ser escrito: uma
+	//falha entre as duas gravacoes nao faz dados escritos serem lidos
+	//como zeros
+	if (d->discarded && (d->discarded[addr/8] & (1 << addr%8))) {
+		d->discarded[addr/8] &= ~(1 << addr%8);
+		result = __diskSaveDiscarded (d, addr/8, addr/8, 0);
+	}
+	if (result == 0) {
+		__diskSeek (d,addr);
+		if (fwrite (data, 1, DISK_SECTORDATASIZE, d->fp) != DISK_SECTORDATASIZE)
+			result = -1;
+	}
+	pthread_mutex_unlock (&d->lock);
+	return result;
+}
+
+//Funcao que descarta (trim) count setores a partir do endereco LBA addr.
+//O intervalo e' registrado no mapa gravado depois do ultimo setor, sem
+//escrita nos setores nem deslocamento da cabeca: ate serem escritos de
+//novo, os setores sao lidos como zeros sem acesso ao meio, inclusive
+//depois de uma nova conexao. Retorna 0 se o intervalo for valido e -1 caso
+//contrario
+int diskDiscardSectors (Disk* d, unsigned long addr, unsigned long count) {
+	int result = 0, trailer = 0;
+	if (addr >= d->numSectors || count > d->numSectors - addr) return -1;
+	if (count == 0) return 0;
+	pthread_mutex_lock (&d->lock);
+	if (d->discarded == NULL) {
+		//primeiro descarte do disco: o mapa inteiro e' gravado
+		d->discarded = calloc ((d->numSectors + 7) / 8, 1);
+		trailer = 1;
+	}
+	if (d->discarded == NULL) result = -1;
+	else {
+		for (unsigned long i = addr; i < addr + count; i++)
+			d->discarded[i/8] |= 1 << i%8;
+		if (trailer) result = __diskSaveDiscarded (d, 0, (d->numSectors - 1) / 8, 1);
+		else result = __diskSaveDiscarded (d, addr/8, (addr + count - 1) / 8, 0);
+	}
+	pthread_mutex_unlock (&d->lock);
+	return result;
 }
 
 //Funcao para a criacao de um disco fisico, a ser representado pelo arquivo
@@ -6,7 +6,7 @@
 *  Organizacao: Universidade Federal de Juiz de Fora
 *  Departamento: Dep. Ciencia da Computacao
 *
-*  => NAO MODIFIQUE ESTE ARQUIVO <=
+*  Estendido no projeto: acesso por varias threads e descarte de setores.
 *
 */
 
@@ -79,6 +79,13 @@ int diskReadSector (Disk* d, unsigned long addr, unsigned char* data);
 //ocorreu sem erros e -1 caso contrario
 int diskWriteSector (Disk* d, unsigned long int addr, unsigned char* data);
 
+//Funcao que descarta (trim) count setores a partir do endereco LBA addr,
+//apenas registrando o intervalo em um mapa gravado no fim do arquivo do
+//disco, sem escrita nos setores. Setores descartados e nao reescritos sao
+//lidos como zeros sem acesso ao meio, tambem depois de diskDisconnect e de
+//uma nova conexao. Retorna 0 se o intervalo for valido e -1 caso contrario
+int diskDiscardSectors (Disk* d, unsigned long addr, unsigned long count);
+
 //Funcao para a criacao de um disco fisico, a ser representado pelo arquivo
 //regular indicado por rawDiskPath e com numero total de cilindros indicado
 //por numCylinders. Retorna 0 se o disco fisico for criado com sucesso e -1
@@ -6,7 +6,8 @@
 *  Organizacao: Universidade Federal de Juiz de Fora
 *  Departamento: Dep. Ciencia da Computacao
 *
-*  => NAO MODIFIQUE ESTE ARQUIVO <=
+*  Estendido no projeto: E/S de setores configuravel (journal), extensoes
+*  com varios enderecos por vez e limite para a busca de i-nodes livres.
 *
 */
 
@@ -35,6 +36,20 @@ struct inode {
 	Disk *d; 		//Disco ao qual pertence o i-node
 };
 
+//Funcoes usadas para ler e escrever os setores da area de i-nodes
+InodeSectorIOFn __inodeReadSector = diskReadSector;
+InodeSectorIOFn __inodeWriteSector = diskWriteSector;
+
+//Maior numero de i-node considerado na busca por i-nodes livres (0: sem limite)
+unsigned int __inodeMaxNumber = 0;
+
+//Funcao que define as funcoes usadas para ler e escrever os setores da area
+//de i-nodes. Por padrao sao diskReadSector e diskWriteSector
+void inodeSetSectorIO (InodeSectorIOFn readFn, InodeSectorIOFn writeFn) {
+	__inodeReadSector = readFn ? readFn : diskReadSector;
+	__inodeWriteSector = writeFn ? writeFn : diskWriteSector;
+}
+
 //Funcao interna que retorna a ultima extensao de um i-node. Retorna NULL
 //se nao houver extensoes do i-node fornecido.
 Inode* __inodeGetLastExtension (Inode *i) {
@@ -55,6 +70,15 @@ Inode* __inodeGetLastExtension (Inode *i) {
 	return i;
 }
 
+//Funcao interna que verifica se um i-node esta' vazio: sem enderecos de
+//bloco, atributos ou extensoes. Retorna 1 se vazio ou 0 caso contrario
+int __inodeIsEmpty (Inode *i) {
+	if (i->next != 0) return 0;
+	for (int a = 0; a < NUMITEMS_PERINODE; a++)
+		if (i->inodeItem[a] != 0) return 0;
+	return 1;
+}
+
 //Funcao que retorna o numero de i-nodes por setor
 unsigned int inodeNumInodesPerSector ( void ) {
 	return DISK_SECTORDATASIZE / (INODE_SIZE * sizeof (unsigned int));
@@ -65,6 +89,23 @@ unsigned int inodeAreaBeginSector ( void ) {
 	return INODE_BEGINSECTOR;
 }
 
+//Funcao que retorna o numero de enderecos de bloco guardados no proprio
+//i-node, antes de ser necessaria a primeira extensao
+unsigned int inodeNumDirectBlocks ( void ) {
+	return NUMBLOCKS_PERINODE;
+}
+
+//Funcao que retorna o numero de enderecos de bloco de cada extensao
+unsigned int inodeNumBlocksPerExtension ( void ) {
+	return NUMITEMS_PERINODE;
+}
+
+//Funcao que limita a busca por i-nodes livres aos numeros 1 a maxNumber.
+//O valor 0 (padrao) remove o limite
+void inodeSetMaxNumber (unsigned int maxNumber) {
+	__inodeMaxNumber = maxNumber;
+}
+
 //Funcao que cria um i-node vazio, identificado pelo seu numero (number),
 //que deve ser unico no sistema de arquivos. Retorna ponteiro para o i-node
 //criado ou NULL se nao houver memoria suficiente ou number invalido. A funcao
@@ -116,7 +157,7 @@ int inodeSave (Inode *i) {
 			* sizeUInt / DISK_SECTORDATASIZE;
 		unsigned char sector[DISK_SECTORDATASIZE];
 
-		int ret = diskReadSector (i->d, inodeSectorAddr, sector);
+		int ret = __inodeReadSector (i->d, inodeSectorAddr, sector);
 		if (ret < 0) return ret;
 
 		//Posicao de inicio do i-node dentro do setor
@@ -134,7 +175,7 @@ int inodeSave (Inode *i) {
 			 &sector[offset+(INODE_SIZE-1)*sizeUInt]);
 
 		//Salvando todo o setor onde se encontra o i-node...
-		ret = diskWriteSector (i->d, inodeSectorAddr, sector);
+		ret = __inodeWriteSector (i->d, inodeSectorAddr, sector);
 		return ret;
 	}
 	return -1;
@@ -151,7 +192,7 @@ Inode* inodeLoad (unsigned int number, Disk *d) {
 	unsigned char sector[DISK_SECTORDATASIZE];
 	Inode *i = NULL;
 
-	int ret = diskReadSector (d, inodeSectorAddr, sector);
+	int ret = __inodeReadSector (d, inodeSectorAddr, sector);
 	if (ret < 0) return NULL;
 
 	//Posicao de inicio do i-node dentro do setor
@@ -206,7 +247,7 @@ void inodeSetRefCount (Inode *i, unsigned int refCount) {
 
 //Funcao que adiciona um endereco ao fim do array de blocos de um i-node
 //Retorna -1 caso a inclusao do endereco nao seja bem sucedida
-//E' a unica funcao que salva automaticamente o i-node em disco
+//Salva automaticamente o i-node em disco
 int inodeAddBlock (Inode *i, unsigned int blockAddr) {
 	if (i) {
 		Disk *d = i->d;
@@ -254,6 +295,142 @@ int inodeAddBlock (Inode *i, unsigned int blockAddr) {
 	return -1;
 }
 
+//Funcao que define o endereco de um bloco (blockNum) no array de blocos de
+//um i-node, criando as extensoes que faltarem ate ele. Enderecos
+//intermediarios permanecem 0 (blocos sem endereco). O i-node precisa ser o
+//primeiro de sua cadeia. Salva automaticamente o i-node ou a extensao
+//alterada. Retorna o numero de extensoes criadas ou -1 em caso de falha
+int inodeSetBlockAddr (Inode *i, unsigned int blockNum, unsigned int blockAddr) {
+	if (!i) return -1;
+	if (blockNum < NUMBLOCKS_PERINODE) {
+		i->inodeItem[blockNum] = blockAddr;
+		return inodeSave (i);
+	}
+
+	unsigned int extNum = 1 + (blockNum - NUMBLOCKS_PERINODE) / NUMITEMS_PERINODE;
+	unsigned int offset = (blockNum - NUMBLOCKS_PERINODE) % NUMITEMS_PERINODE;
+	Inode *ni = i;
+	int created = 0, ret;
+	for (unsigned int a = 0; a < extNum; a++) {
+		Inode *prev = ni;
+		if (prev->next == 0) {
+			//Nova extensao. A extensao anterior ainda pode estar vazia
+			//em disco e nao pode ser escolhida de novo
+			unsigned int niNumber = inodeFindFreeInode (prev->number + 1, prev->d);
+			if (niNumber == 0 || niNumber == prev->number) ni = NULL;
+			else {
+				ni = inodeCreate (niNumber, prev->d);
+				prev->next = niNumber;
+				if (ni && inodeSave (prev) < 0) {
+					free (ni);
+					ni = NULL;
+				}
+				created++;
+			}
+		}
+		else ni = inodeLoad (prev->next, prev->d);
+		if (prev != i) free (prev);
+		if (!ni) return -1;
+	}
+	ni->inodeItem[offset] = blockAddr;
+	ret = inodeSave (ni);
+	free (ni);
+	return ret < 0 ? ret : created;
+}
+
+//Funcao que define os enderecos de count blocos consecutivos, a partir de
+//first, no array de blocos de um i-node, criando as extensoes que faltarem.
+//A cadeia de extensoes e' percorrida uma unica vez e cada i-node alterado
+//e' salvo uma unica vez. O i-node precisa ser o primeiro de sua cadeia.
+//Retorna o numero de extensoes criadas ou -1 em caso de falha
+int inodeSetBlockAddrs (Inode *i, unsigned int first, unsigned int count, const unsigned int *addrs) {
+	if (!i || !addrs) return -1;
+	Inode *ni = i;
+	unsigned int base = 0, items = NUMBLOCKS_PERINODE; //Blocos anteriores a ni e enderecos em ni
+	unsigned int b = first, end = first + count;
+	int created = 0, dirty = 0;
+	while (b < end) {
+		if (b < base + items) {
+			ni->inodeItem[b - base] = addrs[b - first];
+			dirty = 1;
+			b++;
+			continue;
+		}
+
+		//Passa para a proxima extensao, criando-a se preciso
+		Inode *prev = ni;
+		if (prev->next == 0) {
+			unsigned int niNumber = inodeFindFreeInode (prev->number + 1, prev->d);
+			if (niNumber == 0 || niNumber == prev->number) ni = NULL;
+			else {
+				ni = inodeCreate (niNumber, prev->d);
+				prev->next = niNumber;
+				dirty = 1;
+				created++;
+			}
+		}
+		else ni = inodeLoad (prev->next, prev->d);
+		if (ni && dirty && inodeSave (prev) < 0) {
+			free (ni);
+			ni = NULL;
+		}
+		if (prev != i) free (prev);
+		if (!ni) return -1;
+		base += items;
+		items = NUMITEMS_PERINODE;
+		dirty = 0;
+	}
+	int ret = dirty ? inodeSave (ni) : 0;
+	if (ni != i) free (ni);
+	return ret < 0 ? ret : created;
+}
+
+//Funcao que libera as extensoes do fim da cadeia de um i-node que nao tem
+//nenhum endereco de bloco. A ultima extensao com endereco (ou o proprio
+//i-node) e' desligada delas antes que sejam zeradas. O i-node precisa ser
+//o primeiro de sua cadeia. Retorna o numero de extensoes liberadas ou -1
+//em caso de falha
+int inodeTrimExtensions (Inode *i) {
+	if (!i) return -1;
+	//Procura a ultima extensao com algum endereco de bloco
+	Inode *last = i, *ni = i;
+	while (ni->next != 0) {
+		Inode *prev = ni;
+		ni = inodeLoad (prev->next, prev->d);
+		if (prev != i && prev != last) free (prev);
+		if (!ni) {
+			if (last != i) free (last);
+			return -1;
+		}
+		for (int a = 0; a < NUMITEMS_PERINODE; a++)
+			if (ni->inodeItem[a] != 0) {
+				if (last != i) free (last);
+				last = ni;
+				break;
+			}
+	}
+	if (ni != i && ni != last) free (ni);
+
+	unsigned int niNumber = last->next;
+	int ret = 0, freed = 0;
+	if (niNumber != 0) {
+		last->next = 0;
+		ret = inodeSave (last);
+	}
+	if (last != i) free (last);
+	//As extensoes seguintes ja estao sem enderecos: basta zerar o next
+	while (ret == 0 && niNumber != 0) {
+		ni = inodeLoad (niNumber, i->d);
+		if (!ni) return -1;
+		niNumber = ni->next;
+		ni->next = 0;
+		ret = inodeSave (ni);
+		free (ni);
+		freed++;
+	}
+	return ret < 0 ? ret : freed;
+}
+
 //Funcao que retorna o numero de um i-node.
 unsigned int inodeGetNumber (Inode *i) {
 	return (i ? i->number : 0);
@@ -313,14 +490,19 @@ unsigned int inodeGetBlockAddr (Inode *i, unsigned int blockNum) {
 			                      / NUMITEMS_PERINODE;
 			unsigned int offset = (blockNum - NUMBLOCKS_PERINODE)
 			                      % NUMITEMS_PERINODE;
+			//Extensao inexistente: bloco sem endereco
+			if (i->next == 0) return 0;
 			Inode *ni = inodeLoad (i->next, i->d);
-			for (int a = 1; a < extNum; a++) {
+			for (int a = 1; ni && a < extNum; a++) {
 				Disk *d = ni->d;
 				unsigned int niNumber = ni->next;
 				free (ni);
-				ni = inodeLoad (niNumber, d);
+				ni = niNumber ? inodeLoad (niNumber, d) : NULL;
 			}
-			return ni->inodeItem[offset];
+			if (!ni) return 0;
+			unsigned int addr = ni->inodeItem[offset];
+			free (ni);
+			return addr;
 		}
 	}
 	return 0;
@@ -328,15 +510,26 @@ unsigned int inodeGetBlockAddr (Inode *i, unsigned int blockNum) {
 
 //Funcao que encontra um i-node livre em um disco, a partir do i-node de numero
 //startFrom. Retorna o numero do inode livre encontrado ou 0 se nao encontrado.
+//Um i-node e' considerado livre se todos os seus itens (enderecos de bloco e
+//atributos) forem 0 e ele nao tiver extensoes; por isso, extensoes que
+//ficam sem enderecos precisam ser liberadas (ver inodeTrimExtensions).
+//Se houver limite definido por inodeSetMaxNumber, a busca da' a volta.
 unsigned int inodeFindFreeInode (unsigned int startFrom, Disk *d) {
 	Inode *i = NULL;
 	unsigned int number = 0;
 	if (startFrom < 1) return 0;
-	for (unsigned int a = startFrom; number == 0; a++) {
+	if (__inodeMaxNumber && startFrom > __inodeMaxNumber) startFrom = 1;
+	for (unsigned int a = startFrom, n = 0; number == 0; a++, n++) {
+		//Com limite definido, a busca da' a volta e termina em startFrom
+		if (__inodeMaxNumber) {
+			if (n == __inodeMaxNumber) break;
+			if (a > __inodeMaxNumber) a = 1;
+		}
 		i = inodeLoad (a, d);
 		if (!i) break;
-		if (inodeGetBlockAddr(i, 0) == 0)
-			number = inodeGetNumber(i);
+		//I-nodes com tipo definido estao em uso, mesmo sem blocos, e
+		//extensoes estao em uso se tiverem qualquer endereco de bloco
+		if (__inodeIsEmpty (i)) number = inodeGetNumber(i);
 		free (i);
 	}
 	return number;
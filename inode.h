@@ -6,7 +6,8 @@
 *  Organizacao: Universidade Federal de Juiz de Fora
 *  Departamento: Dep. Ciencia da Computacao
 *
-*  => NAO MODIFIQUE ESTE ARQUIVO <=
+*  Estendido no projeto: E/S de setores configuravel (journal), extensoes
+*  com varios enderecos por vez e limite para a busca de i-nodes livres.
 *
 */
 
@@ -18,12 +19,32 @@
 //Tipo para representacao de i-nodes
 typedef struct inode Inode;
 
+//Tipo das funcoes de leitura e escrita de setores usadas pelos i-nodes
+typedef int (*InodeSectorIOFn) (Disk *d, unsigned long addr, unsigned char *data);
+
+//Funcao que define as funcoes usadas para ler e escrever os setores da area
+//de i-nodes. Por padrao sao diskReadSector e diskWriteSector. Permite que o
+//sistema de arquivos encaminhe as escritas de i-nodes para um journal
+void inodeSetSectorIO (InodeSectorIOFn readFn, InodeSectorIOFn writeFn);
+
 //Funcao que retorna o numero de i-nodes por setor
 unsigned int inodeNumInodesPerSector ( void );
 
 //Funcao que retorna o numero do primeiro setor da area de i-nodes
 unsigned int inodeAreaBeginSector ( void );
 
+//Funcao que retorna o numero de enderecos de bloco guardados no proprio
+//i-node, antes de ser necessaria a primeira extensao
+unsigned int inodeNumDirectBlocks ( void );
+
+//Funcao que retorna o numero de enderecos de bloco de cada extensao
+unsigned int inodeNumBlocksPerExtension ( void );
+
+//Funcao que limita a busca por i-nodes livres aos numeros 1 a maxNumber.
+//Com o limite definido, a busca recomeca do i-node 1 ao atingir maxNumber.
+//O valor 0 (padrao) remove o limite
+void inodeSetMaxNumber (unsigned int maxNumber);
+
 //Funcao que cria um i-node vazio, identificado pelo seu numero (number),
 //que deve ser unico no sistema de arquivos. Retorna ponteiro para o i-node
 //criado ou NULL se nao houver memoria suficiente ou number invalido. A funcao
@@ -65,9 +86,30 @@ void inodeSetRefCount (Inode *i, unsigned int refCount);
 
 //Funcao que adiciona um endereco ao fim do array de blocos de um i-node
 //Retorna -1 caso a inclusao do endereco nao seja bem sucedida
-//E' a unica funcao que salva automaticamente o i-node em disco
+//Salva automaticamente o i-node em disco
 int inodeAddBlock (Inode *i, unsigned int blockAddr);
 
+//Funcao que define o endereco de um bloco (blockNum) no array de blocos de
+//um i-node, criando as extensoes que faltarem ate ele. Enderecos
+//intermediarios permanecem 0 (blocos sem endereco). O i-node precisa ser o
+//primeiro de sua cadeia. Salva automaticamente o i-node ou a extensao
+//alterada. Retorna o numero de extensoes criadas ou -1 em caso de falha
+int inodeSetBlockAddr (Inode *i, unsigned int blockNum, unsigned int blockAddr);
+
+//Funcao que define os enderecos de count blocos consecutivos, a partir de
+//first, no array de blocos de um i-node (addrs[0] para o bloco first),
+//criando as extensoes que faltarem. A cadeia de extensoes e' percorrida uma
+//unica vez e cada i-node alterado e' salvo uma unica vez. O i-node precisa
+//ser o primeiro de sua cadeia. Retorna o numero de extensoes criadas ou -1
+//em caso de falha
+int inodeSetBlockAddrs (Inode *i, unsigned int first, unsigned int count, const unsigned int *addrs);
+
+//Funcao que libera as extensoes do fim da cadeia de um i-node que nao tem
+//nenhum endereco de bloco. Ligadas e zeradas, elas pareceriam livres. O
+//i-node precisa ser o primeiro de sua cadeia. Retorna o numero de
+//extensoes liberadas ou -1 em caso de falha
+int inodeTrimExtensions (Inode *i);
+
 //Funcao que retorna o numero de um i-node.
 unsigned int inodeGetNumber (Inode *i);
 
@@ -99,6 +141,8 @@ unsigned int inodeGetBlockAddr (Inode *i, unsigned int blockNum);
 
 //Funcao que encontra um i-node livre em um disco, a partir do i-node de numero
 //startFrom. Retorna o numero do inode livre encontrado ou 0 se nao encontrado.
+//Um i-node e' considerado livre se todos os seus itens (enderecos de bloco e
+//atributos) forem 0 e ele nao tiver extensoes.
 unsigned int inodeFindFreeInode (unsigned int startFrom, Disk *d);
 
 #endif
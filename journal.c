@@ -0,0 +1,593 @@
+/*
+*  journal.c - Journal de metadados (write-ahead log) do MyFS
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "journal.h"
+#include "util.h"
+#include "trace.h"
+
+#define JOURNAL_MAGIC 0x4C4E524A //"JRNL": cabeçalho do journal
+#define JOURNAL_DESC_MAGIC 0x4353444A //"JDSC": descritor de transação
+#define JOURNAL_COMMIT_MAGIC 0x544D434A //"JCMT": confirmação de transação
+
+//cabeçalho (setor JOURNAL_HEADER_SECTOR)
+#define INDEX_JOURNAL_MAGIC 0
+#define INDEX_JOURNAL_START 4 //primeiro setor da área circular
+#define INDEX_JOURNAL_SIZE 8 //quantidade de setores da área circular
+#define INDEX_JOURNAL_TAIL 12 //posição da transação mais antiga não aplicada
+#define INDEX_JOURNAL_SEQ 16 //sequência da transação em INDEX_JOURNAL_TAIL
+
+//uma transação ocupa um ou mais descritores, cada um seguido dos seus
+//setores, e uma única confirmação, cujo checksum cobre todos os setores,
+//inclusive os descritores com os endereços definitivos
+#define INDEX_RECORD_MAGIC 0
+#define INDEX_RECORD_SEQ 4
+#define INDEX_RECORD_COUNT 8 //descritor: quantidade de setores
+#define INDEX_RECORD_CHECKSUM 8 //confirmação: checksum dos setores
+#define INDEX_RECORD_ADDRS 12 //descritor: endereços definitivos dos setores
+
+#define JOURNAL_DESC_MAX ((DISK_SECTORDATASIZE - INDEX_RECORD_ADDRS) / 4) //setores por descritor
+#define JOURNAL_GROUP_OPS 8 //operações agrupadas em uma confirmação
+#define JOURNAL_GROUP_SECTORS 64 //setores pendentes que forçam a confirmação
+#define JOURNAL_COMMIT_INTERVAL 1 //tempo máximo, em segundos, de uma alteração sem confirmação
+#define JOURNAL_NUM_BUCKETS 256
+
+//versões de um setor de metadados mantidas em memória
+typedef struct jsector {
+	unsigned long addr;
+	unsigned char data[DISK_SECTORDATASIZE]; //versão mais recente
+	unsigned char* committed; //versão confirmada no journal e ainda não aplicada
+	int dirty; //1 se data ainda não foi confirmada
+	struct jsector* hashNext;
+} JSector;
+
+typedef struct journal {
+	Disk* d; //NULL se o journal está inativo
+	unsigned int start;
+	unsigned int size;
+	unsigned int head; //posições lógicas, a física é start + pos % size
+	unsigned int tail;
+	unsigned int seq; //sequência da próxima transação
+	unsigned int tailSeq;
+	JSector* buckets[JOURNAL_NUM_BUCKETS];
+	unsigned int numDirty;
+	unsigned int numCommitted;
+	unsigned int depth; //operações em andamento
+	unsigned int pendingOps; //operações terminadas ainda não confirmadas
+	time_t firstPending;
+} Journal;
+
+Journal journal;
+
+//protege journal: as funções públicas são chamadas por várias threads e
+//apenas repassam a chamada à função privada correspondente com o lock
+pthread_mutex_t journalLock = PTHREAD_MUTEX_INITIALIZER;
+
+//função que calcula o checksum (FNV-1a) de um trecho de memória
+unsigned int _journalChecksum(unsigned int h, unsigned char* data, unsigned int size)
+{
+	for(unsigned int i = 0; i < size; i++) {
+		h ^= data[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+//função que retorna o setor físico de uma posição lógica do journal
+unsigned long _journalPhys(unsigned int pos)
+{
+	return journal.start + pos % journal.size;
+}
+
+//função que procura as versões em memória de um setor
+JSector* _journalFind(unsigned long addr)
+{
+	JSector* e = journal.buckets[addr % JOURNAL_NUM_BUCKETS];
+	while(e != NULL && e->addr != addr) e = e->hashNext;
+	return e;
+}
+
+//função que retira um setor da tabela e o libera
+void _journalRemove(JSector* e)
+{
+	JSector** link = &journal.buckets[e->addr % JOURNAL_NUM_BUCKETS];
+	while(*link != e) link = &(*link)->hashNext;
+	*link = e->hashNext;
+	if(e->dirty) journal.numDirty--;
+	if(e->committed) journal.numCommitted--;
+	free(e->committed);
+	free(e);
+}
+
+//função que devolve, ordenados por endereço, os setores sujos (dirty=1)
+//ou confirmados (dirty=0). *count recebe a quantidade
+JSector** _journalCollect(int dirty, unsigned int* count)
+{
+	unsigned int n = dirty ? journal.numDirty : journal.numCommitted;
+	JSector** list = malloc((n ? n : 1) * sizeof(JSector*));
+	if(list == NULL) return NULL;
+
+	*count = 0;
+	for(int b = 0; b < JOURNAL_NUM_BUCKETS; b++) {
+		for(JSector* e = journal.buckets[b]; e != NULL; e = e->hashNext) {
+			if(dirty ? e->dirty : e->committed != NULL) list[(*count)++] = e;
+		}
+	}
+
+	//ordenação por inserção: endereços crescentes percorrem os cilindros em uma só direção
+	for(unsigned int i = 1; i < *count; i++) {
+		JSector* e = list[i];
+		int j = i - 1;
+		while(j >= 0 && list[j]->addr > e->addr) {
+			list[j+1] = list[j];
+			j--;
+		}
+		list[j+1] = e;
+	}
+	return list;
+}
+
+//função que grava o cabeçalho do journal
+int _journalWriteHeader(Disk* d, unsigned int start, unsigned int size, unsigned int tail, unsigned int seq)
+{
+	unsigned char sector[DISK_SECTORDATASIZE] = {0};
+	ul2char(JOURNAL_MAGIC, &sector[INDEX_JOURNAL_MAGIC]);
+	ul2char(start, &sector[INDEX_JOURNAL_START]);
+	ul2char(size, &sector[INDEX_JOURNAL_SIZE]);
+	ul2char(tail, &sector[INDEX_JOURNAL_TAIL]);
+	ul2char(seq, &sector[INDEX_JOURNAL_SEQ]);
+	return diskWriteSector(d, JOURNAL_HEADER_SECTOR, sector);
+}
+
+//função que retorna quantas posições do journal ocupa uma transação de
+//count setores: os descritores, os setores e a confirmação
+unsigned int _journalNeed(unsigned int count)
+{
+	return count + (count + JOURNAL_DESC_MAX - 1) / JOURNAL_DESC_MAX + 1;
+}
+
+//função que grava no journal uma transação com os count setores de list:
+//um descritor a cada JOURNAL_DESC_MAX setores, seguido deles, e uma única
+//confirmação no fim, em posições consecutivas
+int _journalLogRecord(JSector** list, unsigned int count)
+{
+	unsigned char desc[DISK_SECTORDATASIZE];
+	unsigned char commit[DISK_SECTORDATASIZE] = {0};
+	unsigned int checksum = 2166136261u;
+	unsigned int pos = journal.head;
+
+	for(unsigned int i = 0; i < count; i += JOURNAL_DESC_MAX) {
+		unsigned int n = count - i < JOURNAL_DESC_MAX ? count - i : JOURNAL_DESC_MAX;
+		memset(desc, 0, DISK_SECTORDATASIZE);
+		ul2char(JOURNAL_DESC_MAGIC, &desc[INDEX_RECORD_MAGIC]);
+		ul2char(journal.seq, &desc[INDEX_RECORD_SEQ]);
+		ul2char(n, &desc[INDEX_RECORD_COUNT]);
+		for(unsigned int j = 0; j < n; j++) ul2char(list[i+j]->addr, &desc[INDEX_RECORD_ADDRS + j*4]);
+		checksum = _journalChecksum(checksum, desc, DISK_SECTORDATASIZE);
+		for(unsigned int j = 0; j < n; j++) checksum = _journalChecksum(checksum, list[i+j]->data, DISK_SECTORDATASIZE);
+		if(diskWriteSector(journal.d, _journalPhys(pos++), desc) == -1) return -1;
+		for(unsigned int j = 0; j < n; j++) {
+			if(diskWriteSector(journal.d, _journalPhys(pos++), list[i+j]->data) == -1) return -1;
+		}
+	}
+	ul2char(JOURNAL_COMMIT_MAGIC, &commit[INDEX_RECORD_MAGIC]);
+	ul2char(journal.seq, &commit[INDEX_RECORD_SEQ]);
+	ul2char(checksum, &commit[INDEX_RECORD_CHECKSUM]);
+	if(diskWriteSector(journal.d, _journalPhys(pos++), commit) == -1) return -1;
+
+	journal.head = pos;
+	journal.seq++;
+	return 0;
+}
+
+//função que lê e valida a transação na posição pos do journal, guardando
+//seus setores como confirmados. retorna a quantidade de posições que ela
+//ocupa, 0 se não houver transação confirmada em pos (fim do journal) ou
+//-1 se ela não puder ser lida ou guardada
+int _journalReplayRecord(unsigned int pos, unsigned int seq)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int magic, recordSeq, count, checksum, expected = 2166136261u;
+	unsigned char* data = NULL;
+	unsigned int* addrs = NULL;
+	unsigned int total = 0, p = pos;
+	int ret = 0;
+
+	//descritores e setores até a confirmação; uma transação sem
+	//confirmação válida foi interrompida e é descartada
+	while(ret == 0) {
+		if(p - pos >= journal.size) break;
+		if(diskReadSector(journal.d, _journalPhys(p), sector) == -1) {
+			ret = -1;
+			break;
+		}
+		char2ul(&sector[INDEX_RECORD_MAGIC], &magic);
+		char2ul(&sector[INDEX_RECORD_SEQ], &recordSeq);
+		if(recordSeq != seq || (magic != JOURNAL_DESC_MAGIC && magic != JOURNAL_COMMIT_MAGIC)) break;
+
+		if(magic == JOURNAL_COMMIT_MAGIC) {
+			char2ul(&sector[INDEX_RECORD_CHECKSUM], &checksum);
+			if(checksum != expected) break;
+
+			//sem memória para algum setor a transação não pode ser
+			//repetida inteira, e as seguintes dependem dela
+			for(unsigned int i = 0; i < total && ret == 0; i++) {
+				JSector* e = _journalFind(addrs[i]);
+				if(e == NULL) {
+					e = calloc(1, sizeof(JSector));
+					if(e == NULL) {
+						ret = -1;
+						break;
+					}
+					e->addr = addrs[i];
+					e->hashNext = journal.buckets[addrs[i] % JOURNAL_NUM_BUCKETS];
+					journal.buckets[addrs[i] % JOURNAL_NUM_BUCKETS] = e;
+				}
+				if(e->committed == NULL) {
+					e->committed = malloc(DISK_SECTORDATASIZE);
+					if(e->committed == NULL) {
+						ret = -1;
+						break;
+					}
+					journal.numCommitted++;
+				}
+				memcpy(e->data, &data[i*DISK_SECTORDATASIZE], DISK_SECTORDATASIZE);
+				memcpy(e->committed, e->data, DISK_SECTORDATASIZE);
+			}
+			if(ret == 0) ret = p + 1 - pos;
+			break;
+		}
+
+		char2ul(&sector[INDEX_RECORD_COUNT], &count);
+		if(count > JOURNAL_DESC_MAX || p - pos + count + 2 > journal.size) break;
+		unsigned char* moreData = realloc(data, (total + count + 1) * DISK_SECTORDATASIZE);
+		if(moreData != NULL) data = moreData;
+		unsigned int* moreAddrs = realloc(addrs, (total + count + 1) * sizeof(unsigned int));
+		if(moreAddrs != NULL) addrs = moreAddrs;
+		if(moreData == NULL || moreAddrs == NULL) {
+			ret = -1;
+			break;
+		}
+
+		expected = _journalChecksum(expected, sector, DISK_SECTORDATASIZE);
+		for(unsigned int i = 0; i < count && ret == 0; i++) {
+			unsigned char* dst = &data[(total+i)*DISK_SECTORDATASIZE];
+			if(diskReadSector(journal.d, _journalPhys(p+1+i), dst) == -1) ret = -1;
+			char2ul(&sector[INDEX_RECORD_ADDRS + i*4], &addrs[total+i]);
+			expected = _journalChecksum(expected, dst, DISK_SECTORDATASIZE);
+		}
+		total += count;
+		p += count + 1;
+	}
+
+	free(data);
+	free(addrs);
+	return ret;
+}
+
+//Funcao que cria um journal vazio ocupando size setores a partir do setor
+//start do disco d. Retorna 0 se bem sucedido ou -1 caso contrario
+int journalFormat(Disk* d, unsigned long start, unsigned int size)
+{
+	unsigned char sector[DISK_SECTORDATASIZE] = {0};
+	if(d == NULL || size < 3 || start + size > diskGetNumSectors(d)) return -1;
+
+	//a área não é zerada: invalida apenas a primeira posição, para que um
+	//journal anterior no mesmo lugar não seja repetido
+	if(diskWriteSector(d, start, sector) == -1) return -1;
+	return _journalWriteHeader(d, start, size, 0, 1);
+}
+
+//Funcao que retorna quantos setores o journal precisa ter para confirmar
+//inteira uma operacao de ate maxSectors setores: as operacoes agrupadas
+//somam no maximo JOURNAL_GROUP_SECTORS - 1 setores quando ela comeca
+unsigned int journalSizeFor(unsigned int maxSectors)
+{
+	return _journalNeed(JOURNAL_GROUP_SECTORS - 1 + maxSectors);
+}
+
+//função que marca o inicio de uma operacao de metadados
+void _journalBegin(void)
+{
+	journal.depth++;
+}
+
+//função que aplica todas as transacoes confirmadas em suas posicoes
+//definitivas, em ordem de cilindro, liberando o espaco do journal
+int _journalCheckpoint(void)
+{
+	unsigned int count;
+	if(journal.d == NULL) return 0;
+
+	JSector** list = _journalCollect(0, &count);
+	if(list == NULL) return -1;
+
+	for(unsigned int i = 0; i < count; i++) {
+		if(diskWriteSector(journal.d, list[i]->addr, list[i]->committed) == -1) {
+			free(list);
+			return -1;
+		}
+	}
+	for(unsigned int i = 0; i < count; i++) {
+		JSector* e = list[i];
+		free(e->committed);
+		e->committed = NULL;
+		journal.numCommitted--;
+		if(!e->dirty) _journalRemove(e);
+	}
+	free(list);
+	TRACE_EVENT(TRACE_OP_JCHECKPOINT, journal.seq, count);
+
+	journal.tail = journal.head;
+	journal.tailSeq = journal.seq;
+	return _journalWriteHeader(journal.d, journal.start, journal.size, journal.tail, journal.tailSeq);
+}
+
+//função que confirma imediatamente a transacao em andamento
+int _journalSync(void)
+{
+	unsigned int count;
+	if(journal.d == NULL || !journal.numDirty) return 0;
+
+	JSector** list = _journalCollect(1, &count);
+	if(list == NULL) return -1;
+
+	//_journalWriteSector não deixa o conjunto pendente passar do tamanho
+	//do journal: toda confirmação cabe nele depois de um checkpoint
+	unsigned int need = _journalNeed(count);
+	int ret = need > journal.size ? -1 : 0;
+	if(ret == 0 && journal.size - (journal.head - journal.tail) < need) ret = _journalCheckpoint();
+
+	if(ret == 0) ret = _journalLogRecord(list, count);
+	for(unsigned int i = 0; i < count && ret == 0; i++) {
+		JSector* e = list[i];
+		if(e->committed == NULL) {
+			e->committed = malloc(DISK_SECTORDATASIZE);
+			if(e->committed == NULL) {
+				ret = -1;
+				break;
+			}
+			journal.numCommitted++;
+		}
+		memcpy(e->committed, e->data, DISK_SECTORDATASIZE);
+		e->dirty = 0;
+		journal.numDirty--;
+	}
+
+	free(list);
+	journal.pendingOps = 0;
+	TRACE_DEBUG("journal: %u setores confirmados (seq %u)", count, journal.seq);
+	TRACE_EVENT(TRACE_OP_JCOMMIT, journal.seq, count);
+	return ret;
+}
+
+//função que marca o fim de uma operacao de metadados. As transacoes de
+//varias operacoes sao agrupadas e confirmadas juntas (group commit)
+int _journalEnd(void)
+{
+	if(journal.depth > 0) journal.depth--;
+	if(journal.d == NULL || journal.depth > 0 || !journal.numDirty) return 0;
+
+	if(!journal.pendingOps++) journal.firstPending = time(NULL);
+	if(journal.pendingOps >= JOURNAL_GROUP_OPS || journal.numDirty >= JOURNAL_GROUP_SECTORS ||
+		time(NULL) - journal.firstPending >= JOURNAL_COMMIT_INTERVAL) {
+		return _journalSync();
+	}
+	return 0;
+}
+
+//função que confirma as alteracoes pendentes, aplica o journal nas posicoes
+//definitivas e o desativa. Retorna 0 se bem sucedido ou -1
+int _journalClose(void)
+{
+	if(journal.d == NULL) return 0;
+	if(_journalSync() == -1 || _journalCheckpoint() == -1) return -1;
+
+	for(int b = 0; b < JOURNAL_NUM_BUCKETS; b++) {
+		while(journal.buckets[b] != NULL) _journalRemove(journal.buckets[b]);
+	}
+	journal.d = NULL;
+	return 0;
+}
+
+//função que ativa o journal do disco d, repetindo (se replay diferente de 0)
+//as transacoes confirmadas que ainda nao haviam sido aplicadas.
+//Retorna 0 se bem sucedido ou -1
+int _journalOpen(Disk* d, int replay)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int magic;
+
+	if(journal.d != NULL && _journalClose() == -1) return -1;
+	if(diskReadSector(d, JOURNAL_HEADER_SECTOR, sector) == -1) return -1;
+	char2ul(&sector[INDEX_JOURNAL_MAGIC], &magic);
+	if(magic != JOURNAL_MAGIC) return 0; //disco sem journal
+
+	memset(&journal, 0, sizeof(Journal));
+	journal.d = d;
+	char2ul(&sector[INDEX_JOURNAL_START], &journal.start);
+	char2ul(&sector[INDEX_JOURNAL_SIZE], &journal.size);
+	char2ul(&sector[INDEX_JOURNAL_TAIL], &journal.tail);
+	char2ul(&sector[INDEX_JOURNAL_SEQ], &journal.tailSeq);
+	if(journal.size < 3 || journal.start + journal.size > diskGetNumSectors(d)) {
+		journal.d = NULL;
+		return -1;
+	}
+
+	//percorre as transações confirmadas a partir da mais antiga
+	journal.head = journal.tail;
+	journal.seq = journal.tailSeq;
+	while(replay && journal.head - journal.tail < journal.size) {
+		int used = _journalReplayRecord(journal.head, journal.seq);
+		if(used == -1) {
+			//as transações já lidas também não são aplicadas: o journal
+			//fica como está, para ser repetido em uma nova montagem
+			TRACE_ERROR("journal: transação %u não pôde ser repetida", journal.seq);
+			for(int b = 0; b < JOURNAL_NUM_BUCKETS; b++) {
+				while(journal.buckets[b] != NULL) _journalRemove(journal.buckets[b]);
+			}
+			journal.d = NULL;
+			return -1;
+		}
+		if(used == 0) break;
+		journal.head += used;
+		journal.seq++;
+	}
+
+	return _journalCheckpoint();
+}
+
+//função que escreve um setor de metadados na transacao em andamento
+int _journalWriteSector(Disk* d, unsigned long addr, unsigned char* data)
+{
+	if(journal.d != d) return diskWriteSector(d, addr, data);
+	if(addr >= diskGetNumSectors(d)) return -1;
+
+	//o conjunto pendente nunca passa do tamanho do journal: uma operação
+	//que altera mais setores do que ele comporta é recusada, pois não
+	//poderia ser confirmada inteira
+	JSector* e = _journalFind(addr);
+	if((e == NULL || !e->dirty) && _journalNeed(journal.numDirty + 1) > journal.size) {
+		TRACE_ERROR("journal: operação maior que o journal (%u setores)", journal.size);
+		return -1;
+	}
+	if(e == NULL) {
+		e = calloc(1, sizeof(JSector));
+		if(e == NULL) return -1;
+		e->addr = addr;
+		e->hashNext = journal.buckets[addr % JOURNAL_NUM_BUCKETS];
+		journal.buckets[addr % JOURNAL_NUM_BUCKETS] = e;
+	}
+	if(!e->dirty) {
+		e->dirty = 1;
+		journal.numDirty++;
+	}
+	memcpy(e->data, data, DISK_SECTORDATASIZE);
+
+	//escrita fora de uma operação é confirmada como uma operação isolada
+	if(!journal.depth) {
+		_journalBegin();
+		return _journalEnd();
+	}
+	return 0;
+}
+
+//função que descarta versoes pendentes de um setor que deixou de conter
+//metadados. Versoes ja registradas no journal sao aplicadas antes, para
+//que nao sejam repetidas sobre os novos dados apos uma falha
+int _journalForget(unsigned long addr)
+{
+	if(journal.d == NULL) return 0;
+	JSector* e = _journalFind(addr);
+	if(e == NULL) return 0;
+	if(e->committed != NULL) {
+		if(_journalCheckpoint() == -1) return -1;
+		e = _journalFind(addr);
+	}
+	if(e != NULL) _journalRemove(e);
+	return 0;
+}
+
+//Funcao que retorna o tamanho da area circular do journal ativo
+unsigned int journalGetSize(void)
+{
+	pthread_mutex_lock(&journalLock);
+	unsigned int size = journal.d != NULL ? journal.size : 0;
+	pthread_mutex_unlock(&journalLock);
+	return size;
+}
+
+//Funcao que ativa o journal do disco d
+int journalOpen(Disk* d, int replay)
+{
+	pthread_mutex_lock(&journalLock);
+	int ret = _journalOpen(d, replay);
+	pthread_mutex_unlock(&journalLock);
+	return ret;
+}
+
+//Funcao que confirma as alteracoes pendentes e desativa o journal
+int journalClose(void)
+{
+	pthread_mutex_lock(&journalLock);
+	int ret = _journalClose();
+	pthread_mutex_unlock(&journalLock);
+	return ret;
+}
+
+//Funcao que marca o inicio de uma operacao de metadados
+void journalBegin(void)
+{
+	pthread_mutex_lock(&journalLock);
+	_journalBegin();
+	pthread_mutex_unlock(&journalLock);
+}
+
+//Funcao que marca o fim de uma operacao de metadados
+int journalEnd(void)
+{
+	pthread_mutex_lock(&journalLock);
+	int ret = _journalEnd();
+	pthread_mutex_unlock(&journalLock);
+	return ret;
+}
+
+//Funcao que confirma imediatamente a transacao em andamento
+int journalSync(void)
+{
+	pthread_mutex_lock(&journalLock);
+	int ret = _journalSync();
+	pthread_mutex_unlock(&journalLock);
+	return ret;
+}
+
+//Funcao que aplica as transacoes confirmadas em suas posicoes definitivas
+int journalCheckpoint(void)
+{
+	pthread_mutex_lock(&journalLock);
+	int ret = _journalCheckpoint();
+	pthread_mutex_unlock(&journalLock);
+	return ret;
+}
+
+//Funcao que le um setor de metadados, considerando as versoes ainda nao
+//aplicadas que estao no journal. Setores fora do journal sao lidos do disco
+//sem o lock: uma versao so' deixa a memoria depois de aplicada no disco
+int journalReadSector(Disk* d, unsigned long addr, unsigned char* data)
+{
+	pthread_mutex_lock(&journalLock);
+	JSector* e = journal.d == d ? _journalFind(addr) : NULL;
+	if(e != NULL) memcpy(data, e->data, DISK_SECTORDATASIZE);
+	pthread_mutex_unlock(&journalLock);
+	if(e == NULL) return diskReadSector(d, addr, data);
+	return 0;
+}
+
+//Funcao que escreve um setor de metadados na transacao em andamento
+int journalWriteSector(Disk* d, unsigned long addr, unsigned char* data)
+{
+	pthread_mutex_lock(&journalLock);
+	int ret = _journalWriteSector(d, addr, data);
+	pthread_mutex_unlock(&journalLock);
+	return ret;
+}
+
+//Funcao que descarta versoes pendentes de um setor que deixou de conter
+//metadados
+int journalForget(unsigned long addr)
+{
+	pthread_mutex_lock(&journalLock);
+	int ret = _journalForget(addr);
+	pthread_mutex_unlock(&journalLock);
+	return ret;
+}
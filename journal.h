@@ -0,0 +1,77 @@
+/*
+*  journal.h - Journal de metadados (write-ahead log) do MyFS
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+
+//Setor que guarda o cabecalho do journal (posicao e inicio do log)
+#define JOURNAL_HEADER_SECTOR 1
+
+//Funcao que retorna quantos setores a area circular do journal precisa ter
+//para que uma operacao que altere ate maxSectors setores de metadados seja
+//sempre confirmada inteira, em uma unica transacao, junto com as operacoes
+//anteriores ainda agrupadas
+unsigned int journalSizeFor (unsigned int maxSectors);
+
+//Funcao que cria um journal vazio ocupando size setores a partir do setor
+//start do disco d. Retorna 0 se bem sucedido ou -1 caso contrario
+int journalFormat (Disk *d, unsigned long start, unsigned int size);
+
+//Funcao que ativa o journal do disco d. Se replay for diferente de 0, repete
+//as transacoes confirmadas que ainda nao haviam sido aplicadas; um disco
+//desmontado corretamente tem o journal vazio e pode dispensar essa busca.
+//Discos sem journal sao aceitos e passam a ser escritos diretamente.
+//Retorna 0 se bem sucedido ou -1, inclusive se uma transacao confirmada nao
+//puder ser lida ou guardada (nesse caso nada e' aplicado)
+int journalOpen (Disk *d, int replay);
+
+//Funcao que retorna quantos setores tem a area circular do journal ativo
+//ou 0 se nao houver journal ativo
+unsigned int journalGetSize (void);
+
+//Funcao que confirma as alteracoes pendentes, aplica o journal nas posicoes
+//definitivas e o desativa. Retorna 0 se bem sucedido ou -1
+int journalClose (void);
+
+//Funcao que marca o inicio de uma operacao de metadados. As escritas feitas
+//ate o journalEnd correspondente pertencem a mesma transacao
+void journalBegin (void);
+
+//Funcao que marca o fim de uma operacao de metadados. As transacoes de
+//varias operacoes sao agrupadas e confirmadas juntas em uma unica escrita
+//sequencial (group commit). Retorna 0 se bem sucedido ou -1
+int journalEnd (void);
+
+//Funcao que confirma imediatamente a transacao em andamento.
+//Retorna 0 se bem sucedido ou -1
+int journalSync (void);
+
+//Funcao que aplica todas as transacoes confirmadas em suas posicoes
+//definitivas, em ordem de cilindro, liberando o espaco do journal.
+//Retorna 0 se bem sucedido ou -1
+int journalCheckpoint (void);
+
+//Funcao que le um setor de metadados, considerando as versoes ainda nao
+//aplicadas que estao no journal. Mesma interface de diskReadSector
+int journalReadSector (Disk *d, unsigned long addr, unsigned char *data);
+
+//Funcao que escreve um setor de metadados na transacao em andamento. Com o
+//journal inativo, escreve diretamente no disco. Uma operacao que altere
+//mais setores do que o journal comporta e' recusada (retorno -1), sem
+//confirmar parte dela. Mesma interface de diskWriteSector
+int journalWriteSector (Disk *d, unsigned long addr, unsigned char *data);
+
+//Funcao que descarta versoes pendentes de um setor que deixou de conter
+//metadados (ex.: bloco liberado e reaproveitado para dados)
+int journalForget (unsigned long addr);
+
+#endif
@@ -0,0 +1,126 @@
+/*
+*  lz.c - Compressor LZ77 simples usado na compressao de blocos do MyFS
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*/
+
+#include <string.h>
+#include "lz.h"
+
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+
+//função que calcula o índice da tabela hash para os 4 bytes em p
+unsigned int _lzHash(const unsigned char* p)
+{
+	unsigned int v = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+//função que grava o restante (acima de 14) de um tamanho em dst. retorna
+//a nova posição em dst ou -1 se não couber
+int _lzPutLength(unsigned char* dst, int o, unsigned int cap, unsigned int len)
+{
+	for(len -= 15; ; len -= 255) {
+		if((unsigned int) o >= cap) return -1;
+		dst[o++] = len >= 255 ? 255 : len;
+		if(len < 255) return o;
+	}
+}
+
+//função que grava um comando: literais src[lit..lit+numLit) seguidos de
+//uma repetição de matchLen bytes à distância offset (matchLen 0 no último
+//comando). retorna a nova posição em dst ou -1
+int _lzPutSequence(unsigned char* dst, int o, unsigned int cap, const unsigned char* lit,
+	unsigned int numLit, unsigned int offset, unsigned int matchLen)
+{
+	unsigned int m = matchLen ? matchLen - LZ_MIN_MATCH : 0;
+	if((unsigned int) o >= cap) return -1;
+	dst[o++] = ((numLit < 15 ? numLit : 15) << 4) | (m < 15 ? m : 15);
+	if(numLit >= 15 && (o = _lzPutLength(dst, o, cap, numLit)) == -1) return -1;
+	if(numLit > cap - o) return -1;
+	memcpy(&dst[o], lit, numLit);
+	o += numLit;
+	if(!matchLen) return o;
+
+	if(cap - o < 2) return -1;
+	dst[o++] = offset & 0xFF;
+	dst[o++] = offset >> 8;
+	if(m >= 15 && (o = _lzPutLength(dst, o, cap, m)) == -1) return -1;
+	return o;
+}
+
+//função que lê a continuação de um tamanho. retorna -1 se os dados acabarem
+int _lzGetLength(const unsigned char* src, unsigned int n, unsigned int* i, unsigned int* len)
+{
+	unsigned char b;
+	do {
+		if(*i >= n) return -1;
+		b = src[(*i)++];
+		*len += b;
+	} while(b == 255);
+	return 0;
+}
+
+//Funcao que comprime os n bytes de src em dst
+int lzCompress(const unsigned char* src, unsigned int n, unsigned char* dst, unsigned int cap)
+{
+	unsigned int table[1 << LZ_HASH_BITS]; //posição + 1 da última ocorrência
+	memset(table, 0, sizeof(table));
+
+	int o = 0;
+	unsigned int anchor = 0, i = 0;
+	while(n >= LZ_MIN_MATCH && i <= n - LZ_MIN_MATCH) {
+		unsigned int h = _lzHash(&src[i]);
+		unsigned int cand = table[h];
+		table[h] = i + 1;
+		if(!cand || i - (cand - 1) > LZ_MAX_OFFSET || memcmp(&src[cand - 1], &src[i], LZ_MIN_MATCH) != 0) {
+			i++;
+			continue;
+		}
+
+		unsigned int ref = cand - 1;
+		unsigned int len = LZ_MIN_MATCH;
+		while(i + len < n && src[ref + len] == src[i + len]) len++;
+
+		o = _lzPutSequence(dst, o, cap, &src[anchor], i - anchor, i - ref, len);
+		if(o == -1) return -1;
+		i += len;
+		anchor = i;
+	}
+
+	return _lzPutSequence(dst, o, cap, &src[anchor], n - anchor, 0, 0);
+}
+
+//Funcao que descomprime os n bytes de src, produzindo size bytes em dst
+int lzDecompress(const unsigned char* src, unsigned int n, unsigned char* dst, unsigned int size)
+{
+	unsigned int i = 0, o = 0;
+	while(o < size) {
+		if(i >= n) return -1;
+		unsigned int token = src[i++];
+		unsigned int numLit = token >> 4;
+		if(numLit == 15 && _lzGetLength(src, n, &i, &numLit) == -1) return -1;
+		if(numLit > n - i || numLit > size - o) return -1;
+		memcpy(&dst[o], &src[i], numLit);
+		i += numLit;
+		o += numLit;
+		if(o == size) break;
+
+		if(n - i < 2) return -1;
+		unsigned int offset = src[i] | (src[i+1] << 8);
+		i += 2;
+		unsigned int len = token & 15;
+		if(len == 15 && _lzGetLength(src, n, &i, &len) == -1) return -1;
+		len += LZ_MIN_MATCH;
+		if(offset == 0 || offset > o || len > size - o) return -1;
+
+		//a repetição pode sobrepor o trecho que está sendo produzido
+		for(unsigned int k = 0; k < len; k++, o++) dst[o] = dst[o - offset];
+	}
+	return 0;
+}
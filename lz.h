@@ -0,0 +1,34 @@
+/*
+*  lz.h - Compressor LZ77 simples usado na compressao de blocos do MyFS
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*  Formato: uma sequencia de comandos, cada um com um byte de controle (4 bits
+*  de literais e 4 bits de tamanho da repeticao menos LZ_MIN_MATCH), os bytes
+*  literais e a distancia da repeticao (2 bytes). Tamanhos iguais a 15
+*  continuam em bytes seguintes, somados ate um byte menor que 255. O ultimo
+*  comando tem apenas literais. O tamanho descomprimido nao e' gravado: quem
+*  descomprime ja o conhece (o tamanho do bloco)
+*
+*/
+
+#ifndef LZ_H
+#define LZ_H
+
+//Menor repeticao codificada, em bytes
+#define LZ_MIN_MATCH 4
+
+//Funcao que comprime os n bytes de src em dst, que tem capacidade para cap
+//bytes. Retorna o tamanho comprimido ou -1 se ele nao couber em dst (dados
+//pouco compressiveis)
+int lzCompress (const unsigned char *src, unsigned int n, unsigned char *dst, unsigned int cap);
+
+//Funcao que descomprime os n bytes de src, produzindo exatamente size bytes
+//em dst. Bytes de src alem do fim dos dados sao ignorados. Retorna 0 ou -1
+//se os dados estiverem corrompidos
+int lzDecompress (const unsigned char *src, unsigned int n, unsigned char *dst, unsigned int size);
+
+#endif
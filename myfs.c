@@ -12,246 +12,4066 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
 #include "myfs.h"
 #include "vfs.h"
 #include "inode.h"
 #include "util.h"
+#include "dcache.h"
+#include "journal.h"
+#include "trace.h"
+#include "lz.h"
 
 #define INDEX_TOTALBLOCKS 0 //index no superbloco para encontrar o total de blocos
 #define INDEX_BLOCKSIZE 4 //index no superbloco para encontrar o tamanho do bloco
 #define INDEX_SECTOR_INIT 8 //index no superbloco para encontrar o setor inicial livre
 #define INDEX_SIZE_BITMAP 12 //index no superbloco para encontrar a quantidade de blocos de arquivos
 #define INDEX_BLOCK_ROOT 16 //index no superbloco para encontrar o block do diretorio root
-#define INDEX_BITMAP 20 //index no superbloco para encontrar o bitmap dos blocos livres
+#define INDEX_BITMAP_SECTOR 20 //index no superbloco para encontrar o primeiro setor do bitmap dos blocos livres
+#define INDEX_BITMAP_NUMSECTORS 24 //index no superbloco para encontrar a quantidade de setores do bitmap
+#define INDEX_FREE_BLOCKS 28 //index no superbloco para encontrar a quantidade de blocos livres
+#define INDEX_FREE_INODES 32 //index no superbloco para encontrar a quantidade de inodes livres
+#define INDEX_MAGIC 36 //index no superbloco para encontrar o identificador do formato
+#define INDEX_STATE 40 //index no superbloco para encontrar o estado de montagem
+#define INDEX_REFCOUNT_SECTOR 44 //index no superbloco para encontrar o primeiro setor da tabela de referências
+#define INDEX_SNAPSHOTS 48 //index no superbloco para encontrar os descritores dos snapshots
+#define INDEX_FLAGS 80 //index no superbloco para encontrar as opções do volume (MYFS_FLAG_*)
+#define INDEX_FINGERPRINT_SECTOR 84 //index no superbloco para encontrar o primeiro setor da tabela de impressões digitais
+#define INDEX_NUM_GROUPS 88 //index no superbloco para encontrar a quantidade de grupos de cilindros
+#define INDEX_GROUP_SECTORS 92 //index no superbloco para encontrar a quantidade de setores de cada grupo
+#define INDEX_GROUP_BLOCKS 96 //index no superbloco para encontrar a quantidade de blocos de dados de cada grupo
 
-#define ID_INODE_DEFAULT 1 
-#define NUM_SECTOR_INIT_INODE 2 //bloco default para começar a armazenar os inodes
+#define MYFS_MAGIC 0x5346594D //"MYFS"
+#define BITS_PER_SECTOR (DISK_SECTORDATASIZE*8) //blocos representados por setor do bitmap
+#define REFCOUNT_MAX 255 //referências extras que um bloco pode ter (um byte por bloco)
+#define FINGERPRINT_SIZE 4 //bytes por bloco na tabela de impressões digitais
+#define MAX_SNAPSHOTS MYFS_MAX_SNAPSHOTS
+
+#define MYFS_STATE_CLEAN 1 //desmontado corretamente, journal vazio
+#define MYFS_STATE_MOUNTED 2 //montado ou não desmontado corretamente
+
+#define MYFS_FLAG_COMPRESS 1 //blocos de dados gravados passam a ser comprimidos
+#define MYFS_FLAG_DEDUP 2 //blocos de dados repetidos passam a ser compartilhados
+
+//Entradas do mapa de blocos dos arquivos: endereço do primeiro setor do
+//bloco nos bits baixos, nos 7 bits seguintes quantos setores guardam o
+//bloco comprimido (0 para um bloco sem compressão) e, no bit mais alto, a
+//marca de bloco reservado por myFSAllocate e ainda não escrito, lido como
+//zeros. Blocos de diretório nunca são comprimidos nem reservados
+#define BLOCKADDR_BITS 24
+#define BLOCKADDR_MASK ((1u << BLOCKADDR_BITS) - 1)
+#define BLOCKADDR_ZSECTORS_MAX 0x7F
+#define BLOCKADDR_UNWRITTEN (1u << 31)
+#define BLOCKADDR(entry) ((entry) & BLOCKADDR_MASK)
+#define BLOCKADDR_ZSECTORS(entry) (((entry) >> BLOCKADDR_BITS) & BLOCKADDR_ZSECTORS_MAX)
+
+#define TABLE_LOADED 1 //setor da tabela já lido do disco
+#define TABLE_DIRTY 2 //setor da tabela alterado desde a última gravação
+
+#define ID_INODE_DEFAULT 1 //inode do diretório raiz
+#define SECTOR_JOURNAL 2 //primeiro setor do journal, logo depois do cabeçalho
+#define JOURNAL_DIR_BLOCKS 4 //blocos de diretório alterados, no máximo, por uma operação
+
+//A área de dados é dividida em grupos de cilindros, cada um com uma fatia
+//dos inodes seguida dos seus blocos de dados. Os inodes continuam
+//numerados como se estivessem em setores consecutivos a partir de
+//inodeAreaBeginSector (setores lógicos), e cada setor lógico é levado ao
+//grupo correspondente na leitura e na escrita
+#define CG_MAX_GROUPS 16 //potência de 2 que divide a quantidade de setores de inodes
+#define CG_MIN_CYLINDERS 16 //menor grupo, em cilindros
 
 #define MAX_INODES 1024 // numero maximo de inodes
-#define MAX_FILES 1024
-#define MAX_OPEN_FILES 128
+#define CHECK_THREADS 4 //threads da verificação de consistência, se não informado
+#define CHECK_MAX_THREADS 16
+#define FD_PAGE_SIZE 128 //descritores por página da tabela, que cresce sob demanda uma página por vez
+#define FD_MAX_PAGES 256
+#define DEFRAG_SCAN_INODES 64 //inodes percorridos, no máximo, por um passo do desfragmentador
+#define BCACHE_BLOCKS 64 //blocos de dados do cache de leitura (myFSRead e myFSBorrow)
+#define OPEN_FILES_BUCKETS_INITIAL 64 //baldes iniciais da tabela hash de arquivos abertos
 #define MAX_FILE_LENGTH 255
 
-#define DIR_RAIZ "/root"
+//Entradas de diretório são registros de tamanho variável que nunca cruzam
+//a fronteira de um setor: numero do inode (4 bytes), tamanho do registro
+//(2 bytes), tamanho do nome (1 byte), tipo do arquivo (1 byte) e o nome
+#define DIRENTRY_INODE 0
+#define DIRENTRY_RECLEN 4
+#define DIRENTRY_NAMELEN 6
+#define DIRENTRY_TYPE 7
+#define DIRENTRY_HEADER 8
+#define DIRENTRY_SIZE(nameLen) ((DIRENTRY_HEADER + (nameLen) + 3) & ~3) //alinhado em 4 bytes
+
+//Palavras de um inode na área de inodes (ver inode.c), usadas pela
+//verificação de consistência, que lê a área inteira de uma vez: endereços
+//dos blocos diretos, tipo, tamanho, contador de referências e próxima
+//extensão. Extensões guardam endereços nas palavras antes do numero, que
+//continua gravado nos inodes livres
+#define RAWINODE_WORDS 16
+#define RAWINODE_TYPE 8
+#define RAWINODE_SIZE 9
+#define RAWINODE_OWNER 10
+#define RAWINODE_PERMISSION 12
+#define RAWINODE_REFCOUNT 13
+#define RAWINODE_NUMBER 14
+#define RAWINODE_NEXT 15
+
+//**************************************************
+// VARIÁVEIS GLOBAIS - CRIADAS PELOS ALUNOS
+//**************************************************
+
+
+FSInfo* fileSystem;
+
+//arquivo aberto: existe um por inode, compartilhado por todos os
+//descritores abertos para ele
+typedef struct openFile {
+	Inode* inode;
+	unsigned int number;
+	unsigned int type; // FILETYPE_REGULAR ou FILETYPE_DIR
+	unsigned int refCount; // quantidade de descritores que usam o arquivo
+	unsigned int view; // snapshot de onde o arquivo foi aberto (0: sistema ativo)
+	pthread_rwlock_t lock; // leituras compartilham o inode; escrita, reserva e truncamento o têm exclusivo
+	struct openFile* hashNext;
+} OpenFile;
+
+typedef struct files {
+	OpenFile* file; // NULL se fechado
+	unsigned int cursor; // posição atual, em bytes, dentro do arquivo ou diretório
+	int nextFree; // próxima entrada da lista de livres, se fechado
+	pthread_rwlock_t lock; // exclusivo para usar o cursor, compartilhado pelas operações posicionais: o descritor não é fechado no meio de uma operação
+} FileDescriptor;
+
+typedef struct fdTable {
+	FileDescriptor* pages[FD_MAX_PAGES]; // páginas de descritores, que nunca mudam de lugar
+	unsigned int size; // descritores nas páginas alocadas
+	int freeList; // índice da primeira entrada livre ou -1
+	unsigned int openCount; // descritores em uso, lido sem lock por myFSIsIdle
+	OpenFile** buckets; // arquivos abertos indexados pelo numero do inode
+	unsigned int numBuckets;
+	unsigned int numOpenFiles;
+} FdTable;
+
+//bloco de dados guardado no cache de leitura. o buffer é copiado pelas
+//leituras ou emprestado por myFSBorrow e não é reaproveitado enquanto
+//pins > 0
+typedef struct cachedBlock {
+	unsigned int addr; // endereço do bloco no disco (0: bloco de zeros dos buracos)
+	unsigned int size; // tamanho do buffer, o do bloco no momento da leitura
+	unsigned int pins; // leituras e empréstimos em andamento
+	unsigned int valid; // conteúdo igual ao do disco: pode ser encontrado pelo endereço
+	unsigned long lru; // instante do último uso
+	unsigned char* data;
+} CachedBlock;
+
+//tabela de metadados em setores consecutivos, lida setor a setor sob
+//demanda e gravada apenas nos setores alterados
+typedef struct sectorTable {
+	unsigned char* data;
+	unsigned char* flags; // um byte por setor: TABLE_LOADED e TABLE_DIRTY
+	unsigned int sector;
+	unsigned int numSectors;
+} SectorTable;
+
+typedef struct superblock {
+	Disk* disk;
+	Disk* pinned; // disco montado por myFSMount, que não dá lugar a outro (NULL: nenhum)
+	SectorTable bitMap; // um bit por bloco de dados, 1 para ocupado
+	SectorTable refCount; // um byte por bloco de dados: referências além da primeira
+	SectorTable fingerprints; // hash do conteúdo de cada bloco de dados (0: bloco não indexado)
+	unsigned int totalBlocks;
+	unsigned int blockSize;
+	unsigned int sectorInit;
+	unsigned int sizeBitMap; // quantidade de blocos de dados
+	unsigned int blockRoot;
+	unsigned int freeBlocks;
+	unsigned int freeInodes;
+	unsigned int state; // MYFS_STATE_*
+	unsigned int dirty; // 1 se o setor do superbloco precisa ser gravado
+	unsigned int numGroups; // grupos de cilindros
+	unsigned int groupSectors; // setores de cada grupo: fatia de inodes e blocos de dados
+	unsigned int groupBlocks; // blocos de dados de cada grupo
+	unsigned int nextDirGroup; // grupo do próximo diretório criado
+	unsigned int nextFreeBlock[CG_MAX_GROUPS]; // dicas, por grupo, para a busca de blocos e inodes livres
+	unsigned int nextFreeInode[CG_MAX_GROUPS];
+	unsigned int snapshots[MAX_SNAPSHOTS]; // descritor de cada snapshot (0: posição livre)
+	unsigned int flags; // MYFS_FLAG_*
+	unsigned char* zBlock; // último bloco comprimido lido ou gravado, descomprimido
+	unsigned char* zData; // dados comprimidos a gravar
+	unsigned int zEntry; // entrada do mapa correspondente a zBlock (0: nenhuma)
+	unsigned long long zIn, zOut; // bytes comprimidos e bytes gravados desde a montagem
+	unsigned int* dedupSlots; // índice em memória das impressões digitais: pares (hash, bloco + 1)
+	unsigned int dedupSize; // quantidade de pares (potência de 2)
+	unsigned int dedupUsed; // pares ocupados, inclusive os que ficaram desatualizados
+	unsigned long long dedupHits; // blocos não gravados por já existirem, desde a montagem
+	unsigned int defragNext; // inode em que o próximo passo do desfragmentador começa
+	unsigned int defragBlock; // bloco de defragNext em que ele continua
+	unsigned int defragRun; // índice no bitmap do destino do próximo bloco de defragNext
+	unsigned int defragIdle; // inodes percorridos desde o último bloco movido
+} SuperBlock;
+
+//snapshot visto pelas operações de uma thread
+typedef struct view {
+	unsigned int id; // 0: sistema ativo
+	unsigned int map[DISK_SECTORDATASIZE/sizeof(unsigned int)]; // blocos da cópia dos inodes do snapshot
+} View;
+
+//setores lógicos da área de inodes lidos e alterados em memória pela
+//liberação em lote de um arquivo
+typedef struct inodeBatch {
+	unsigned char* data;
+	unsigned char* flags; //TABLE_LOADED e TABLE_DIRTY de cada setor
+} InodeBatch;
+
+//entrada de diretório encontrada pela verificação de consistência
+typedef struct checkEntry {
+	unsigned int dir;
+	unsigned int target; // inode apontado pela entrada
+	unsigned int pos; // posição do registro nos blocos de diretório lidos
+} CheckEntry;
+
+//estado da verificação de consistência: cópias em memória da área de
+//inodes e dos blocos de diretório, lidas na ordem do disco e corrigidas
+//em memória antes de gravadas
+typedef struct check {
+	unsigned int* inodes; // RAWINODE_WORDS palavras por inode, a partir do inode 1
+	unsigned int* snapInodes[MAX_SNAPSHOTS]; // área de inodes de cada snapshot (NULL: não existe)
+	unsigned char* inodeDirty; // um byte por inode: 1 se corrigido
+	unsigned int* owner; // inode principal de cada inode em uso (0: livre)
+	unsigned int* dirFirst; // primeiro bloco de cada diretório em dirAddrs
+	unsigned int* dirCount; // quantidade de blocos de cada diretório
+	unsigned int* dirDotDot; // inode apontado pelo ".." de cada diretório (0: sem "..")
+	unsigned int* dirDotDotPos; // posição do registro ".." em dirData
+	unsigned int* dirAddrs; // endereço de cada bloco de diretório, agrupados por diretório
+	unsigned char* dirDirty; // um byte por bloco de diretório: 1 se corrigido
+	unsigned char* dirData; // conteúdo dos blocos de diretório
+	unsigned int numDirBlocks;
+	struct checkWorker* workers; // uma por thread
+	unsigned int numThreads;
+	int repair;
+} Check;
+
+//trabalho de uma thread da verificação de consistência
+typedef struct checkWorker {
+	Check* c;
+	unsigned int id;
+	unsigned short* refs; // referências encontradas a cada bloco de dados
+	CheckEntry* entries; // entradas de diretório encontradas
+	unsigned int numEntries, maxEntries;
+	MyFSCheckStat st; // inconsistências encontradas pela thread
+	int ret;
+} CheckWorker;
+
+SuperBlock superblock;
+FdTable fdTable = { {NULL}, 0, -1, 0, NULL, 0, 0 };
+_Thread_local View view;
+
+//as funções públicas podem ser chamadas por várias threads. os locks são
+//sempre obtidos nesta ordem, e o journal, o disco e o rastreamento têm
+//locks próprios, obtidos por último:
+// fsLock: exclusivo para montar, desmontar, formatar, verificar,
+//   desfragmentar, clonar, criar e remover snapshots e mudar as opções do
+//   volume; compartilhado pelas demais operações
+// nsLock: caminhos, diretórios, cache de entradas, arquivos abertos e
+//   alocação e liberação de descritores
+// FileDescriptor.lock e OpenFile.lock: cursor do descritor e inode aberto
+// allocLock: alocador e demais metadados alterados (bitmap, tabelas,
+//   contadores do superbloco, setores de inodes e transações do journal),
+//   só enquanto eles mudam. leituras, percursos de caminhos e a escrita
+//   de dados em blocos já alocados não o obtêm
+// zLock: bloco comprimido guardado em memória (zBlock, zData e zEntry)
+// cacheLock: cache de blocos lidos (bcache), de leituras e empréstimos
+pthread_rwlock_t fsLock = PTHREAD_RWLOCK_INITIALIZER;
+pthread_mutex_t nsLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t allocLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t zLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+CachedBlock bcache[BCACHE_BLOCKS];
+unsigned int bcacheValid; // entradas válidas, lido sem lock para evitar a busca
+unsigned long bcacheClock; // relógio do lru
+
+//**************************************************
+// FUNÇÕES PRIVADAS - CRIADAS PELOS ALUNOS
+//**************************************************
+
+//função que retorna a quantidade de setores de um bloco
+unsigned int _sectorsPerBlock(void)
+{
+	return superblock.blockSize / DISK_SECTORDATASIZE;
+}
+
+//função que retorna a quantidade de setores da fatia de inodes de cada
+//grupo de cilindros
+unsigned int _inodeSliceSectors(void)
+{
+	return MAX_INODES / inodeNumInodesPerSector() / superblock.numGroups;
+}
+
+//função que retorna o índice no bitmap do bloco de endereço addr
+unsigned int _blockIndex(unsigned int addr)
+{
+	unsigned int off = addr - superblock.sectorInit;
+	unsigned int group = off / superblock.groupSectors;
+	return group * superblock.groupBlocks + (off % superblock.groupSectors - _inodeSliceSectors()) / _sectorsPerBlock();
+}
+
+//função que retorna o endereço do bloco de índice index no bitmap
+unsigned int _blockAddr(unsigned int index)
+{
+	unsigned int group = index / superblock.groupBlocks;
+	return superblock.sectorInit + group * superblock.groupSectors + _inodeSliceSectors() +
+		(index % superblock.groupBlocks) * _sectorsPerBlock();
+}
+
+//função que retorna o grupo de cilindros de um inode
+unsigned int _inodeGroup(unsigned int number)
+{
+	return (number - 1) / (MAX_INODES / superblock.numGroups);
+}
+
+//função que retorna a entrada válida do cache para o bloco addr, com o
+//tamanho de bloco atual, ou NULL. deve ser chamada com cacheLock
+CachedBlock* _bcacheFind(unsigned int addr)
+{
+	for(int i = 0; i < BCACHE_BLOCKS; i++) {
+		CachedBlock* c = &bcache[i];
+		if(c->valid && c->addr == addr && c->size == superblock.blockSize) return c;
+	}
+	return NULL;
+}
+
+//função que escolhe uma entrada do cache não presa para receber o
+//bloco addr, de preferência inválida ou, senão, a usada há mais tempo, e
+//a deixa inválida e com um buffer do tamanho de bloco atual. deve ser
+//chamada com cacheLock. retorna NULL se todas estiverem presas
+CachedBlock* _bcacheVictim(unsigned int addr)
+{
+	CachedBlock* victim = NULL;
+	for(int i = 0; i < BCACHE_BLOCKS; i++) {
+		CachedBlock* c = &bcache[i];
+		if(c->pins) continue;
+		if(victim == NULL || (victim->valid && (!c->valid || c->lru < victim->lru))) victim = c;
+	}
+	if(victim == NULL) return NULL;
+
+	if(victim->size != superblock.blockSize) {
+		unsigned char* data = realloc(victim->data, superblock.blockSize);
+		if(data == NULL) return NULL;
+		victim->data = data;
+		victim->size = superblock.blockSize;
+	}
+	if(victim->valid) __atomic_sub_fetch(&bcacheValid, 1, __ATOMIC_RELAXED);
+	victim->valid = 0;
+	victim->addr = addr;
+	return victim;
+}
+
+//função que tira do cache o bloco addr, que foi alocado ou vai ser
+//alterado no disco. empréstimos em andamento continuam com o conteúdo
+//antigo
+void _bcacheInvalidate(unsigned int addr)
+{
+	if(!__atomic_load_n(&bcacheValid, __ATOMIC_RELAXED)) return;
+	pthread_mutex_lock(&cacheLock);
+	for(int i = 0; i < BCACHE_BLOCKS; i++) {
+		if(!bcache[i].valid || bcache[i].addr != addr) continue;
+		bcache[i].valid = 0;
+		__atomic_sub_fetch(&bcacheValid, 1, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&cacheLock);
+}
+
+//função que tira todos os blocos do cache, ao trocar de disco
+void _bcacheInvalidateAll(void)
+{
+	pthread_mutex_lock(&cacheLock);
+	for(int i = 0; i < BCACHE_BLOCKS; i++) bcache[i].valid = 0;
+	__atomic_store_n(&bcacheValid, 0, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&cacheLock);
+}
+
+//função que retorna o setor do disco que guarda o setor lógico addr da
+//área de inodes
+unsigned long _inodeSectorPhys(unsigned long addr)
+{
+	unsigned long k = addr - inodeAreaBeginSector();
+	return superblock.sectorInit + k / _inodeSliceSectors() * superblock.groupSectors + k % _inodeSliceSectors();
+}
+
+//função que retorna a quantidade de setores da área de inodes
+unsigned int _inodeTableSectors(void)
+{
+	return MAX_INODES / inodeNumInodesPerSector();
+}
+
+//função que lê um setor lógico da área de inodes, pelo journal. enquanto
+//a thread vê um snapshot, o setor vem da cópia guardada no snapshot
+int _inodeReadSector(Disk* d, unsigned long addr, unsigned char* data)
+{
+	if(view.id) {
+		unsigned long k = addr - inodeAreaBeginSector();
+		if(k >= _inodeTableSectors()) return -1;
+		return diskReadSector(d, view.map[k / _sectorsPerBlock()] + k % _sectorsPerBlock(), data);
+	}
+	return journalReadSector(d, _inodeSectorPhys(addr), data);
+}
+
+//função que escreve um setor lógico da área de inodes, pelo journal.
+//snapshots são somente leitura
+int _inodeWriteSector(Disk* d, unsigned long addr, unsigned char* data)
+{
+	if(view.id) return -1;
+	return journalWriteSector(d, _inodeSectorPhys(addr), data);
+}
+
+//função que aponta as dicas de busca de cada grupo de cilindros para o
+//seu primeiro bloco e o seu primeiro inode
+void _groupsInit(void)
+{
+	for(unsigned int g = 0; g < superblock.numGroups; g++) {
+		superblock.nextFreeBlock[g] = g * superblock.groupBlocks;
+		superblock.nextFreeInode[g] = g * (MAX_INODES / superblock.numGroups) + 1;
+	}
+	superblock.nextDirGroup = 1;
+}
+
+//função que marca o superbloco como alterado
+void _superBlockDirty(void)
+{
+	superblock.dirty = 1;
+}
+
+//função que retorna a quantidade de setores da tabela de referências
+//para numBlocks blocos de dados
+unsigned int _refCountNumSectors(unsigned int numBlocks)
+{
+	return (numBlocks + DISK_SECTORDATASIZE - 1) / DISK_SECTORDATASIZE;
+}
+
+//função que retorna a quantidade de setores da tabela de impressões
+//digitais para numBlocks blocos de dados
+unsigned int _fingerprintNumSectors(unsigned int numBlocks)
+{
+	return (numBlocks * FINGERPRINT_SIZE + DISK_SECTORDATASIZE - 1) / DISK_SECTORDATASIZE;
+}
+
+//função que retorna o tamanho do journal do disco d: ele comporta a maior
+//operação possível, que altera no máximo o superbloco, a área de inodes,
+//as tabelas (calculadas para o disco inteiro, um limite superior) e
+//JOURNAL_DIR_BLOCKS blocos de diretório. deve ser chamada depois de
+//definido superblock.blockSize
+unsigned int _journalSectors(Disk* d)
+{
+	unsigned int numBlocks = diskGetNumSectors(d) / _sectorsPerBlock();
+	unsigned int tables = (numBlocks + BITS_PER_SECTOR - 1) / BITS_PER_SECTOR +
+		_refCountNumSectors(numBlocks) + _fingerprintNumSectors(numBlocks);
+	return journalSizeFor(1 + _inodeTableSectors() + tables + JOURNAL_DIR_BLOCKS * _sectorsPerBlock());
+}
+
+//função que reserva em memória uma tabela de numSectors setores a partir
+//do setor sector. uma tabela nova (loaded) não precisa ser lida do disco,
+//mas é gravada inteira no próximo _tableFlush
+int _tableInit(SectorTable* t, unsigned int sector, unsigned int numSectors, int loaded)
+{
+	t->sector = sector;
+	t->numSectors = numSectors;
+	t->data = calloc(numSectors, DISK_SECTORDATASIZE);
+	t->flags = calloc(numSectors, 1);
+	if(t->data == NULL || t->flags == NULL) return -1;
+	if(loaded) memset(t->flags, TABLE_LOADED | TABLE_DIRTY, numSectors);
+	return 0;
+}
+
+//função que libera a memória de uma tabela
+void _tableRelease(SectorTable* t)
+{
+	free(t->data);
+	free(t->flags);
+	t->data = NULL;
+	t->flags = NULL;
+}
+
+//função que garante que o setor s da tabela está em memória,
+//lendo-o do disco no primeiro uso
+int _tableLoadSector(SectorTable* t, unsigned int s)
+{
+	if(t->flags[s] & TABLE_LOADED) return 0;
+	if(journalReadSector(superblock.disk, t->sector + s, &t->data[s*DISK_SECTORDATASIZE]) == -1) return -1;
+	t->flags[s] |= TABLE_LOADED;
+	return 0;
+}
+
+//função que retorna o byte i da tabela, lendo seu setor se preciso.
+//retorna NULL em caso de erro
+unsigned char* _tableByte(SectorTable* t, unsigned int i)
+{
+	if(_tableLoadSector(t, i / DISK_SECTORDATASIZE) == -1) return NULL;
+	return &t->data[i];
+}
+
+//função que registra a alteração do byte i da tabela
+void _tableDirty(SectorTable* t, unsigned int i)
+{
+	t->flags[i / DISK_SECTORDATASIZE] |= TABLE_DIRTY;
+	_superBlockDirty();
+}
+
+//função que grava os setores alterados da tabela
+int _tableFlush(Disk* d, SectorTable* t)
+{
+	for(unsigned int s = 0; s < t->numSectors; s++) {
+		if(!(t->flags[s] & TABLE_DIRTY)) continue;
+		if(journalWriteSector(d, t->sector + s, &t->data[s*DISK_SECTORDATASIZE]) == -1) return -1;
+		t->flags[s] &= ~TABLE_DIRTY;
+	}
+	return 0;
+}
+
+//função que altera o bit de um bloco no bitmap, registrando o setor
+//do bitmap alterado e o contador de blocos livres
+int _bitMapSet(unsigned int index, int busy)
+{
+	unsigned char mask = 1 << (index % 8);
+	unsigned char* byte = _tableByte(&superblock.bitMap, index/8);
+	if(byte == NULL) return -1;
+	if(((*byte & mask) != 0) == busy) return 0;
+
+	if(busy) {
+		*byte |= mask;
+		superblock.freeBlocks--;
+	} else {
+		*byte &= ~mask;
+		superblock.freeBlocks++;
+		unsigned int group = index / superblock.groupBlocks;
+		if(index < superblock.nextFreeBlock[group]) superblock.nextFreeBlock[group] = index;
+	}
+	_tableDirty(&superblock.bitMap, index/8);
+	return 0;
+}
+
+//função que retorna o numero de um bloco livre no disco, de preferência
+//no grupo de cilindros group
+//retorna o endereço (setor inicial) do bloco caso encontre
+//se não encontrar nenhum, retorna -1
+int _bitMapGetBlockFree(Disk* d, unsigned int group)
+{
+	unsigned char* bitMap = superblock.bitMap.data;
+	if(!superblock.freeBlocks) return -1;
+
+	//a busca começa na dica de próximo livre do grupo e dá a volta no
+	//bitmap, passando para os grupos seguintes
+	for(unsigned int n = 0, i = superblock.nextFreeBlock[group]; n < superblock.sizeBitMap; n++, i++) {
+		if(i >= superblock.sizeBitMap) i = 0;
+		if((n == 0 || i % BITS_PER_SECTOR == 0) && _tableLoadSector(&superblock.bitMap, i / BITS_PER_SECTOR) == -1) return -1;
+		if(bitMap[i/8] == 0xFF && i % 8 == 0 && i + 8 <= superblock.sizeBitMap) {
+			n += 7; //byte cheio
+			i += 7;
+			continue;
+		}
+		if(!(bitMap[i/8] & (1 << (i % 8)))) {
+			if(i / superblock.groupBlocks == group) superblock.nextFreeBlock[group] = i;
+			return _blockAddr(i);
+		}
+	}
+	return -1;
+}
+
+//função que procura a primeira sequência de count blocos livres
+//consecutivos a partir do bloco de índice start, dando a volta no bitmap.
+//retorna o índice do primeiro bloco ou -1
+int _bitMapFindRun(unsigned int count, unsigned int start)
+{
+	unsigned char* bitMap = superblock.bitMap.data;
+	if(count == 0 || count > superblock.freeBlocks) return -1;
+
+	unsigned int runStart = start;
+	for(unsigned int n = 0, i = start; n < superblock.sizeBitMap; n++, i++) {
+		if(i >= superblock.sizeBitMap) i = runStart = 0; //a sequência não dá a volta
+		if((n == 0 || i % BITS_PER_SECTOR == 0) && _tableLoadSector(&superblock.bitMap, i / BITS_PER_SECTOR) == -1) return -1;
+		if(bitMap[i/8] & (1 << (i % 8))) runStart = i + 1;
+		else if(i + 1 - runStart == count) return runStart;
+	}
+	return -1;
+}
+
+//função que coloca o bloco dado como ocupado
+int _bitMapSetFreePerBusy(int blockFree)
+{
+	_bcacheInvalidate(blockFree);
+	return _bitMapSet(_blockIndex(blockFree), 1);
+}
+
+//função que coloca o bloco dado como desocupado
+int _bitMapSetBusyPerFree(int blockBusy)
+{
+	return _bitMapSet(_blockIndex(blockBusy), 0);
+}
+
+//função que lê a impressão digital do bloco de índice index
+int _fingerprintGet(unsigned int index, unsigned int* fp)
+{
+	unsigned char* bytes = _tableByte(&superblock.fingerprints, index * FINGERPRINT_SIZE);
+	if(bytes == NULL) return -1;
+	char2ul(bytes, fp);
+	return 0;
+}
+
+//função que altera a impressão digital do bloco de índice index
+int _fingerprintSet(unsigned int index, unsigned int fp)
+{
+	unsigned int old;
+	if(_fingerprintGet(index, &old) == -1) return -1;
+	if(old == fp) return 0;
+	ul2char(fp, _tableByte(&superblock.fingerprints, index * FINGERPRINT_SIZE));
+	_tableDirty(&superblock.fingerprints, index * FINGERPRINT_SIZE);
+	return 0;
+}
+
+//função que retorna quantas referências além da primeira o bloco addr
+//possui (blocos compartilhados com snapshots ou clones) ou -1
+int _blockRefs(unsigned int addr)
+{
+	unsigned char* refs = _tableByte(&superblock.refCount, _blockIndex(addr));
+	return refs ? *refs : -1;
+}
+
+//função que acrescenta uma referência ao bloco addr
+int _blockGet(unsigned int addr)
+{
+	unsigned char* refs = _tableByte(&superblock.refCount, _blockIndex(addr));
+	if(refs == NULL || *refs == REFCOUNT_MAX) return -1;
+	(*refs)++;
+	_tableDirty(&superblock.refCount, _blockIndex(addr));
+	return 0;
+}
+
+//função que devolve uma referência ao bloco addr, liberando-o quando
+//não restam outras
+int _blockPut(unsigned int addr)
+{
+	unsigned char* refs = _tableByte(&superblock.refCount, _blockIndex(addr));
+	if(refs == NULL) return -1;
+	if(*refs) {
+		(*refs)--;
+		_tableDirty(&superblock.refCount, _blockIndex(addr));
+		return 0;
+	}
+	TRACE_EVENT(TRACE_OP_BLOCKFREE, 0, addr);
+
+	//o bloco pode voltar a ser usado para metadados, que nunca são
+	//compartilhados: ele sai do índice de deduplicação. o conteúdo
+	//não é mais lido e o disco é avisado (trim)
+	if(_fingerprintSet(_blockIndex(addr), 0) == -1) return -1;
+	diskDiscardSectors(superblock.disk, addr, _sectorsPerBlock());
+	return _bitMapSetBusyPerFree(addr);
+}
+
+//função que escreve no setor zero os campos do superbloco
+int _superBlockSave(Disk* d)
+{
+	unsigned char diskSuperBlock[DISK_SECTORDATASIZE] = {0};
+
+	ul2char(superblock.totalBlocks, &diskSuperBlock[INDEX_TOTALBLOCKS]);
+	ul2char(superblock.blockSize, &diskSuperBlock[INDEX_BLOCKSIZE]);
+	ul2char(superblock.sectorInit, &diskSuperBlock[INDEX_SECTOR_INIT]);
+	ul2char(superblock.sizeBitMap, &diskSuperBlock[INDEX_SIZE_BITMAP]);
+	ul2char(superblock.blockRoot, &diskSuperBlock[INDEX_BLOCK_ROOT]);
+	ul2char(superblock.bitMap.sector, &diskSuperBlock[INDEX_BITMAP_SECTOR]);
+	ul2char(superblock.bitMap.numSectors, &diskSuperBlock[INDEX_BITMAP_NUMSECTORS]);
+	ul2char(superblock.refCount.sector, &diskSuperBlock[INDEX_REFCOUNT_SECTOR]);
+	for(int i = 0; i < MAX_SNAPSHOTS; i++) {
+		ul2char(superblock.snapshots[i], &diskSuperBlock[INDEX_SNAPSHOTS + 4*i]);
+	}
+	ul2char(superblock.freeBlocks, &diskSuperBlock[INDEX_FREE_BLOCKS]);
+	ul2char(superblock.freeInodes, &diskSuperBlock[INDEX_FREE_INODES]);
+	ul2char(MYFS_MAGIC, &diskSuperBlock[INDEX_MAGIC]);
+	ul2char(superblock.state, &diskSuperBlock[INDEX_STATE]);
+	ul2char(superblock.flags, &diskSuperBlock[INDEX_FLAGS]);
+	ul2char(superblock.numGroups, &diskSuperBlock[INDEX_NUM_GROUPS]);
+	ul2char(superblock.groupSectors, &diskSuperBlock[INDEX_GROUP_SECTORS]);
+	ul2char(superblock.groupBlocks, &diskSuperBlock[INDEX_GROUP_BLOCKS]);
+	ul2char(superblock.fingerprints.sector, &diskSuperBlock[INDEX_FINGERPRINT_SECTOR]);
+
+	return journalWriteSector(d, 0, diskSuperBlock);
+}
+
+//função que persiste apenas o que mudou desde a última chamada: o setor
+//do superbloco e os setores alterados do bitmap e da tabela de referências
+int _superBlockFlush(Disk* d)
+{
+	if(!superblock.dirty) return 0;
+
+	if(_tableFlush(d, &superblock.bitMap) == -1) return -1;
+	if(_tableFlush(d, &superblock.refCount) == -1) return -1;
+	if(_tableFlush(d, &superblock.fingerprints) == -1) return -1;
+	if(_superBlockSave(d) == -1) return -1;
+
+	superblock.dirty = 0;
+	return 0;
+}
+
+//função que aloca um bloco livre, marcando-o como ocupado. o bloco fica,
+//se possível, no mesmo grupo de cilindros do inode number (0 para o
+//primeiro grupo). retorna o endereço do bloco ou -1
+int _blockAlloc(Disk* d, unsigned int number)
+{
+	int block = _bitMapGetBlockFree(d, number ? _inodeGroup(number) : 0);
+	if(block == -1 || _bitMapSetFreePerBusy(block) == -1) {
+		TRACE_WARN("sem blocos livres (%u livres no superbloco)", superblock.freeBlocks);
+		return -1;
+	}
+	TRACE_EVENT(TRACE_OP_BLOCKALLOC, 0, block);
+	return block;
+}
+
+//função que cria livres (zerados, exceto o próprio número) os inodes dos
+//setores lógicos first até last - 1 da área de inodes, gravando cada setor
+//uma única vez
+int _initInode(Disk *d, unsigned int first, unsigned int last)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int perSector = inodeNumInodesPerSector();
+
+	for(unsigned int k = first; k < last; k++) {
+		memset(sector, 0, DISK_SECTORDATASIZE);
+		for(unsigned int i = 0; i < perSector; i++) {
+			ul2char(k * perSector + i + 1, &sector[(i * RAWINODE_WORDS + RAWINODE_NUMBER) * sizeof(unsigned int)]);
+		}
+		if(_inodeWriteSector(d, inodeAreaBeginSector() + k, sector) == -1) return -1;
+	}
+	return 0;
+}
+
+//função que obtém um inode livre, de preferência no grupo de cilindros
+//group, e o inicializa com o tipo dado
+//retorna o inode (a ser liberado com free) ou NULL caso não haja
+//inodes livres
+Inode* _inodeAlloc(Disk* d, unsigned int fileType, unsigned int group)
+{
+	if(!superblock.freeInodes) return NULL;
+
+	unsigned int number = inodeFindFreeInode(superblock.nextFreeInode[group], d);
+	if(number == 0) return NULL;
+
+	Inode* inode = inodeCreate(number, d);
+	if(inode == NULL) return NULL;
+
+	inodeSetFileType(inode, fileType);
+	inodeSetRefCount(inode, 1);
+	if(inodeSave(inode) == -1) {
+		free(inode);
+		return NULL;
+	}
+	superblock.freeInodes--;
+	if(_inodeGroup(number) == group) superblock.nextFreeInode[group] = number + 1;
+	_superBlockDirty();
+	return inode;
+}
+
+//função que limpa um inode (e suas extensões), devolvendo-os como livres
+int _inodeRelease(Inode* inode)
+{
+	//conta as extensões, que também voltam a ficar livres
+	unsigned int numInodes = 1;
+	for(unsigned int next = inodeGetNextNumber(inode); next != 0; numInodes++) {
+		Inode* ext = inodeLoad(next, superblock.disk);
+		if(ext == NULL) return -1;
+		next = inodeGetNextNumber(ext);
+		free(ext);
+	}
+
+	if(inodeClear(inode) == -1) return -1;
+	superblock.freeInodes += numInodes;
+	unsigned int group = _inodeGroup(inodeGetNumber(inode));
+	if(inodeGetNumber(inode) < superblock.nextFreeInode[group]) superblock.nextFreeInode[group] = inodeGetNumber(inode);
+	_superBlockDirty();
+	return 0;
+}
+
+//função que define o endereço do bloco de índice blockNum de um inode,
+//contabilizando as extensões de inode criadas para alcançá-lo
+int _inodeSetBlock(Inode* inode, unsigned int blockNum, unsigned int blockAddr)
+{
+	int created = inodeSetBlockAddr(inode, blockNum, blockAddr);
+	if(created == -1) return -1;
+	if(created) {
+		superblock.freeInodes -= created;
+		_superBlockDirty();
+	}
+	return 0;
+}
+
+//função que define os endereços de count blocos consecutivos do mapa de
+//um inode, a partir do bloco first, em uma única passada pelas extensões,
+//contabilizando as extensões criadas
+int _inodeSetBlocks(Inode* inode, unsigned int first, unsigned int count, const unsigned int* addrs)
+{
+	int created = inodeSetBlockAddrs(inode, first, count, addrs);
+	if(created == -1) return -1;
+	if(created) {
+		superblock.freeInodes -= created;
+		_superBlockDirty();
+	}
+	return 0;
+}
+
+//função que libera as extensões do fim da cadeia de um inode que ficaram
+//só com buracos, contabilizando os inodes liberados. deve ser chamada
+//pelos caminhos que trocam endereços por buracos
+int _inodeTrim(Inode* inode)
+{
+	int freed = inodeTrimExtensions(inode);
+	if(freed == -1) return -1;
+	if(freed) {
+		superblock.freeInodes += freed;
+		_superBlockDirty();
+	}
+	return 0;
+}
+
+//função que retorna a quantidade de blocos (com ou sem endereço) do mapa
+//de um inode
+unsigned int _inodeNumBlocks(Inode* inode)
+{
+	return (inodeGetFileSize(inode) + superblock.blockSize - 1) / superblock.blockSize;
+}
+
+//função que acrescenta (get diferente de 0) ou devolve uma referência a
+//cada bloco do mapa de um inode, parando antes do bloco de índice limit.
+//retorna o índice do bloco em que parou (o total de blocos se concluir)
+unsigned int _inodeRefBlocks(Inode* inode, int get, unsigned int limit)
+{
+	if(limit > _inodeNumBlocks(inode)) limit = _inodeNumBlocks(inode);
+	for(unsigned int b = 0; b < limit; b++) {
+		unsigned int addr = BLOCKADDR(inodeGetBlockAddr(inode, b));
+		if(addr && (get ? _blockGet(addr) : _blockPut(addr)) == -1) return b;
+	}
+	return limit;
+}
+
+//função que dá ao inode uma cópia própria do bloco blockNum, de endereço
+//addr, compartilhado com snapshots ou clones (copy-on-write). blocos de
+//diretório (metadata) são copiados pelo journal. retorna o endereço da
+//cópia ou -1
+int _blockCow(Disk* d, Inode* inode, unsigned int blockNum, unsigned int addr, int metadata)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	int copy = _blockAlloc(d, inodeGetNumber(inode));
+	if(copy == -1) return -1;
+
+	for(unsigned int s = 0; s < _sectorsPerBlock(); s++) {
+		int ret;
+		if(metadata) {
+			ret = journalReadSector(d, addr + s, sector);
+			if(ret == 0) ret = journalWriteSector(d, copy + s, sector);
+		} else {
+			journalForget(copy + s);
+			ret = diskReadSector(d, addr + s, sector);
+			if(ret == 0) ret = diskWriteSector(d, copy + s, sector);
+		}
+		if(ret == -1) {
+			_bitMapSetBusyPerFree(copy);
+			return -1;
+		}
+	}
+
+	if(_inodeSetBlock(inode, blockNum, copy) == -1) {
+		_bitMapSetBusyPerFree(copy);
+		return -1;
+	}
+	_blockPut(addr);
+
+	//o superbloco guarda o endereço do primeiro bloco da raiz
+	if(inodeGetNumber(inode) == ID_INODE_DEFAULT && blockNum == 0) {
+		superblock.blockRoot = copy;
+		_superBlockDirty();
+	}
+	return copy;
+}
+
+//função que retorna o arquivo aberto correspondente a um inode do
+//snapshot view (0 para o sistema ativo) ou NULL caso ele não esteja aberto
+OpenFile* _openFileFind(unsigned int number, unsigned int view)
+{
+	if(!fdTable.numBuckets) return NULL;
+	OpenFile* f = fdTable.buckets[number % fdTable.numBuckets];
+	while(f != NULL && (f->number != number || f->view != view)) f = f->hashNext;
+	return f;
+}
+
+//função que retorna o tamanho de um registro de entrada de diretório
+unsigned int _dirEntryRecLen(unsigned char* sector, unsigned int off)
+{
+	return sector[off+DIRENTRY_RECLEN] | (sector[off+DIRENTRY_RECLEN+1] << 8);
+}
+
+//função que modifica o tamanho de um registro de entrada de diretório
+void _dirEntrySetRecLen(unsigned char* sector, unsigned int off, unsigned int recLen)
+{
+	sector[off+DIRENTRY_RECLEN] = recLen & 0xFF;
+	sector[off+DIRENTRY_RECLEN+1] = (recLen >> 8) & 0xFF;
+}
+
+//função que retorna a posição do próximo registro dentro do setor.
+//registros corrompidos encerram a varredura do setor
+unsigned int _dirEntryNext(unsigned char* sector, unsigned int off)
+{
+	unsigned int recLen = _dirEntryRecLen(sector, off);
+	if(recLen < DIRENTRY_HEADER || off + recLen > DISK_SECTORDATASIZE) return DISK_SECTORDATASIZE;
+	return off + recLen;
+}
+
+//função que preenche um registro de entrada de diretório (exceto o tamanho do registro)
+void _dirEntryWrite(unsigned char* sector, unsigned int off, unsigned int number, const char* name, unsigned int fileType)
+{
+	unsigned int nameLen = strlen(name);
+	ul2char(number, &sector[off+DIRENTRY_INODE]);
+	sector[off+DIRENTRY_NAMELEN] = nameLen;
+	sector[off+DIRENTRY_TYPE] = fileType;
+	memcpy(&sector[off+DIRENTRY_HEADER], name, nameLen);
+}
+
+//função que inicializa um setor de diretório sem entradas
+void _dirSectorInit(unsigned char* sector)
+{
+	memset(sector, 0, DISK_SECTORDATASIZE);
+	_dirEntrySetRecLen(sector, 0, DISK_SECTORDATASIZE);
+}
+
+//função que retorna a quantidade de setores ocupados por um diretório
+unsigned int _dirNumSectors(Inode* dir)
+{
+	return inodeGetFileSize(dir) / DISK_SECTORDATASIZE;
+}
+
+//função que retorna o endereço do n-ésimo setor de um diretório
+//ou 0 caso o setor não exista
+unsigned long _dirSectorAddr(Inode* dir, unsigned int n)
+{
+	unsigned int addr = inodeGetBlockAddr(dir, n / _sectorsPerBlock());
+	if(addr == 0) return 0;
+	return addr + n % _sectorsPerBlock();
+}
+
+//função que acrescenta um novo bloco vazio a um diretório. o primeiro
+//setor do bloco é deixado em sector. retorna o endereço do bloco ou -1
+int _dirGrow(Disk* d, Inode* dir, unsigned char* sector)
+{
+	int block = _blockAlloc(d, inodeGetNumber(dir));
+	if(block == -1) return -1;
+
+	_dirSectorInit(sector);
+	for(unsigned int i = 1; i < _sectorsPerBlock(); i++) {
+		if(journalWriteSector(d, block+i, sector) == -1) {
+			_bitMapSetBusyPerFree(block);
+			return -1;
+		}
+	}
+
+	if(_inodeSetBlock(dir, _dirNumSectors(dir) / _sectorsPerBlock(), block) == -1) {
+		_bitMapSetBusyPerFree(block);
+		return -1;
+	}
+	inodeSetFileSize(dir, inodeGetFileSize(dir) + superblock.blockSize);
+	if(inodeSave(dir) == -1) return -1;
+
+	return block;
+}
+
+//função que procura um nome nos blocos de um diretório
+//retorna o numero do inode correspondente ou 0 caso não exista
+unsigned int _dirScan(Disk* d, Inode* dir, const char* name)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int nameLen = strlen(name);
+
+	for(unsigned int s = 0; s < _dirNumSectors(dir); s++) {
+		if(journalReadSector(d, _dirSectorAddr(dir, s), sector) == -1) return 0;
+		for(unsigned int off = 0; off < DISK_SECTORDATASIZE; off = _dirEntryNext(sector, off)) {
+			unsigned int number;
+			char2ul(&sector[off+DIRENTRY_INODE], &number);
+			if(number && sector[off+DIRENTRY_NAMELEN] == nameLen &&
+				!memcmp(&sector[off+DIRENTRY_HEADER], name, nameLen)) {
+				return number;
+			}
+		}
+	}
+	return 0;
+}
+
+//função que procura um nome em um diretório, consultando primeiro a
+//cache de entradas. o resultado da varredura (inclusive negativo)
+//é guardado na cache. retorna o numero do inode ou 0 caso não exista
+unsigned int _dirLookup(Disk* d, unsigned int dirNumber, const char* name)
+{
+	unsigned int number;
+	//a cache guarda apenas o sistema ativo
+	if(!view.id && dcacheLookup(dirNumber, name, &number) == 0) return number;
+
+	TRACE_EVENT(TRACE_OP_LOOKUP, dirNumber, 0);
+	Inode* dir = inodeLoad(dirNumber, d);
+	if(dir == NULL) return 0;
+	number = inodeGetFileType(dir) == FILETYPE_DIR ? _dirScan(d, dir, name) : 0;
+	free(dir);
+
+	if(!view.id) dcacheInsert(dirNumber, name, number);
+	return number;
+}
+
+//função que cria uma nova entrada no diretório dado, reaproveitando
+//o espaço livre dos registros existentes ou acrescentando um bloco.
+//retorna -1 caso de mal sucedido e 0 caso feito com sucesso
+int _addDiretoryEntry(Disk* d, Inode* dir, const char* filename, unsigned int number, unsigned int fileType)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int need = DIRENTRY_SIZE(strlen(filename));
+	unsigned long addr = 0;
+	unsigned int off = 0, found = 0;
+
+	if(filename[0] == '\0' || strlen(filename) > MAX_FILE_LENGTH) return -1;
+
+	//procura um registro com espaço sobrando para a nova entrada
+	for(unsigned int s = 0; s < _dirNumSectors(dir) && !addr; s++) {
+		unsigned long sectorAddr = _dirSectorAddr(dir, s);
+		if(journalReadSector(d, sectorAddr, sector) == -1) return -1;
+		for(off = 0; off < DISK_SECTORDATASIZE; off = _dirEntryNext(sector, off)) {
+			unsigned int entryNumber;
+			char2ul(&sector[off+DIRENTRY_INODE], &entryNumber);
+			unsigned int recLen = _dirEntryRecLen(sector, off);
+			unsigned int used = entryNumber ? DIRENTRY_SIZE(sector[off+DIRENTRY_NAMELEN]) : 0;
+			if(recLen < used + need) continue;
+			if(used) { //divide o registro, a nova entrada fica com a sobra
+				_dirEntrySetRecLen(sector, off, used);
+				off += used;
+				_dirEntrySetRecLen(sector, off, recLen - used);
+			}
+			addr = sectorAddr;
+			found = s;
+			break;
+		}
+	}
+
+	//bloco compartilhado com um snapshot ou clone: a entrada vai para uma cópia
+	if(addr) {
+		unsigned int blockNum = found / _sectorsPerBlock();
+		unsigned int block = inodeGetBlockAddr(dir, blockNum);
+		int refs = _blockRefs(block);
+		if(refs == -1) return -1;
+		if(refs > 0) {
+			int copy = _blockCow(d, dir, blockNum, block, 1);
+			if(copy == -1) return -1;
+			addr = copy + found % _sectorsPerBlock();
+		}
+	}
+
+	//diretório cheio, acrescenta um novo bloco
+	if(!addr) {
+		int block = _dirGrow(d, dir, sector);
+		if(block == -1) return -1;
+		addr = block;
+		off = 0;
+	}
+
+	_dirEntryWrite(sector, off, number, filename, fileType);
+	if(journalWriteSector(d, addr, sector) == -1) return -1;
+	TRACE_DEBUG("dir %u: entrada '%s' -> inode %u no setor %lu", inodeGetNumber(dir), filename, number, addr);
+	TRACE_EVENT(TRACE_OP_DIRADD, number, addr);
+
+	dcacheInsert(inodeGetNumber(dir), filename, number);
+	return 0;
+}
+
+//função que remove a entrada name de um diretório: o registro é juntado
+//ao anterior do mesmo setor ou, se for o primeiro, apenas fica sem inode.
+//retorna -1 caso de mal sucedido e 0 caso feito com sucesso
+int _removeDirectoryEntry(Disk* d, Inode* dir, const char* name)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int nameLen = strlen(name);
+
+	for(unsigned int s = 0; s < _dirNumSectors(dir); s++) {
+		unsigned long addr = _dirSectorAddr(dir, s);
+		if(journalReadSector(d, addr, sector) == -1) return -1;
+		for(unsigned int off = 0, prev = 0; off < DISK_SECTORDATASIZE; prev = off, off = _dirEntryNext(sector, off)) {
+			unsigned int number;
+			char2ul(&sector[off+DIRENTRY_INODE], &number);
+			if(!number || sector[off+DIRENTRY_NAMELEN] != nameLen || memcmp(&sector[off+DIRENTRY_HEADER], name, nameLen)) continue;
+
+			if(off == 0) ul2char(0, &sector[off+DIRENTRY_INODE]);
+			else _dirEntrySetRecLen(sector, prev, _dirEntryRecLen(sector, prev) + _dirEntryRecLen(sector, off));
+
+			//bloco compartilhado com um snapshot ou clone: a remoção vai para uma cópia
+			unsigned int blockNum = s / _sectorsPerBlock();
+			unsigned int block = inodeGetBlockAddr(dir, blockNum);
+			int refs = _blockRefs(block);
+			if(refs == -1) return -1;
+			if(refs > 0) {
+				int copy = _blockCow(d, dir, blockNum, block, 1);
+				if(copy == -1) return -1;
+				addr = copy + s % _sectorsPerBlock();
+			}
+			if(journalWriteSector(d, addr, sector) == -1) return -1;
+			TRACE_DEBUG("dir %u: entrada '%s' (inode %u) removida do setor %lu", inodeGetNumber(dir), name, number, addr);
+
+			dcacheInsert(inodeGetNumber(dir), name, 0);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+//função que indica se um diretório tem apenas as entradas "." e ".."
+//retorna 1 se estiver vazio, 0 se não estiver ou -1
+int _dirIsEmpty(Disk* d, Inode* dir)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+
+	for(unsigned int s = 0; s < _dirNumSectors(dir); s++) {
+		if(journalReadSector(d, _dirSectorAddr(dir, s), sector) == -1) return -1;
+		for(unsigned int off = 0; off < DISK_SECTORDATASIZE; off = _dirEntryNext(sector, off)) {
+			unsigned int number;
+			char2ul(&sector[off+DIRENTRY_INODE], &number);
+			if(!number) continue;
+			unsigned int nameLen = sector[off+DIRENTRY_NAMELEN];
+			if(nameLen == 0 || nameLen > 2 || memcmp(&sector[off+DIRENTRY_HEADER], "..", nameLen)) return 0;
+		}
+	}
+	return 1;
+}
+
+//função que inicializa o primeiro bloco de um diretório recém criado
+//com as entradas "." e "..". retorna o endereço do bloco ou -1
+int _dirInitBlock(Disk* d, Inode* dir, unsigned int parentNumber)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	int block = _dirGrow(d, dir, sector);
+	if(block == -1) return -1;
+
+	_dirEntryWrite(sector, 0, inodeGetNumber(dir), ".", FILETYPE_DIR);
+	_dirEntrySetRecLen(sector, 0, DIRENTRY_SIZE(1));
+	_dirEntryWrite(sector, DIRENTRY_SIZE(1), parentNumber, "..", FILETYPE_DIR);
+	_dirEntrySetRecLen(sector, DIRENTRY_SIZE(1), DISK_SECTORDATASIZE - DIRENTRY_SIZE(1));
+	if(journalWriteSector(d, block, sector) == -1) return -1;
+
+	return block;
+}
+
+//função que cria um arquivo (ou diretório) de nome name dentro do
+//diretório parentNumber. retorna o inode criado ou NULL
+Inode* _createEntry(Disk* d, unsigned int parentNumber, const char* name, unsigned int fileType)
+{
+	//um diretório aberto usa o inode do arquivo aberto, que precisa
+	//acompanhar as alterações (novos blocos e cópias de blocos)
+	OpenFile* open = _openFileFind(parentNumber, 0);
+	Inode* parent = open ? open->inode : inodeLoad(parentNumber, d);
+	if(parent == NULL) return NULL;
+
+	//arquivos ficam no grupo de cilindros do diretório pai, perto dele;
+	//diretórios são espalhados entre os grupos
+	unsigned int group = _inodeGroup(parentNumber);
+	if(fileType == FILETYPE_DIR) group = superblock.nextDirGroup++ % superblock.numGroups;
+
+	Inode* inode = _inodeAlloc(d, fileType, group);
+	if(inode == NULL) {
+		if(!open) free(parent);
+		return NULL;
+	}
+
+	int block = 0;
+	if(fileType == FILETYPE_DIR) block = _dirInitBlock(d, inode, parentNumber);
+	if(block == -1 || _addDiretoryEntry(d, parent, name, inodeGetNumber(inode), fileType) == -1) {
+		//desfaz a criação
+		if(block > 0) _bitMapSetBusyPerFree(block);
+		_inodeRelease(inode);
+		free(inode);
+		inode = NULL;
+	}
+
+	if(!open) free(parent);
+	return inode;
+}
+
+//função que extrai o próximo componente de *path para name,
+//avançando *path. retorna o tamanho do componente (0 se o caminho
+//terminou) ou -1 se exceder MAX_FILE_LENGTH
+int _pathNextComponent(const char** path, char* name)
+{
+	const char* p = *path;
+	int len = 0;
+
+	while(*p == '/') p++;
+	while(p[len] != '\0' && p[len] != '/') len++;
+	if(len > MAX_FILE_LENGTH) return -1;
+
+	memcpy(name, p, len);
+	name[len] = '\0';
+	*path = p + len;
+	return len;
+}
+
+//função que percorre o caminho a partir do diretório raiz até o
+//penúltimo componente. escreve em *parent o inode do diretório pai e
+//em name o último componente (vazio se o caminho for a própria raiz).
+//retorna 0 ou -1 caso algum diretório intermediário não exista
+int _pathWalk(Disk* d, const char* path, unsigned int* parent, char* name)
+{
+	char component[MAX_FILE_LENGTH+1];
+	unsigned int current = ID_INODE_DEFAULT;
+
+	int len = _pathNextComponent(&path, name);
+	while(len > 0) {
+		len = _pathNextComponent(&path, component);
+		if(len <= 0) break;
+		current = _dirLookup(d, current, name);
+		if(current == 0) return -1;
+		strcpy(name, component);
+	}
+	if(len < 0) return -1;
+
+	*parent = current;
+	return 0;
+}
+
+//função que faz a thread ver o snapshot id nas leituras de inodes, que
+//também se tornam somente leitura. id 0 é o próprio sistema ativo.
+//retorna 0 ou -1
+int _viewEnter(unsigned int id)
+{
+	if(id == 0 || id == view.id) return 0;
+	if(id > MAX_SNAPSHOTS || !superblock.snapshots[id-1]) return -1;
+
+	unsigned char sector[DISK_SECTORDATASIZE];
+	if(diskReadSector(superblock.disk, superblock.snapshots[id-1], sector) == -1) return -1;
+	for(unsigned int i = 0; i < DISK_SECTORDATASIZE/sizeof(unsigned int); i++) {
+		char2ul(&sector[4*i], &view.map[i]);
+	}
+	view.id = id;
+	return 0;
+}
+
+//função que faz a thread voltar a ver o sistema ativo
+void _viewLeave(void)
+{
+	view.id = 0;
+}
+
+//função que acrescenta (get diferente de 0) ou devolve uma referência a
+//todos os blocos dos inodes de numero menor que upto, na área de inodes
+//vista no momento. em caso de erro desfaz o que fez e retorna -1
+int _inodeTableRefBlocks(Disk* d, int get, unsigned int upto)
+{
+	for(unsigned int number = 1; number < upto; number++) {
+		Inode* inode = inodeLoad(number, d);
+		if(inode == NULL) {
+			_inodeTableRefBlocks(d, !get, number);
+			return -1;
+		}
+
+		//extensões guardam endereços no lugar do tipo, mas nenhum endereço
+		//de bloco coincide com um tipo: o primeiro bloco de dados fica
+		//depois de FILETYPE_DIR (ver myFSFormat)
+		unsigned int type = inodeGetFileType(inode);
+		if(type == FILETYPE_REGULAR || type == FILETYPE_DIR) {
+			unsigned int done = _inodeRefBlocks(inode, get, UINT_MAX);
+			if(done < _inodeNumBlocks(inode)) {
+				_inodeRefBlocks(inode, !get, done);
+				free(inode);
+				_inodeTableRefBlocks(d, !get, number);
+				return -1;
+			}
+		}
+		free(inode);
+	}
+	return 0;
+}
+
+//função que grava o snapshot id: copia a área de inodes para blocos
+//novos, listados no bloco descritor, e acrescenta uma referência a cada
+//bloco usado pelos inodes. retorna 0 ou -1
+int _snapshotCreate(Disk* d, unsigned int id)
+{
+	unsigned char desc[DISK_SECTORDATASIZE] = {0};
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int numCopies = (_inodeTableSectors() + _sectorsPerBlock() - 1) / _sectorsPerBlock();
+	unsigned int copies[DISK_SECTORDATASIZE/sizeof(unsigned int)];
+	unsigned int n = 0;
+	int ret = 0;
+
+	int descBlock = _blockAlloc(d, 0);
+	if(descBlock == -1) return -1;
+	for(; n < numCopies; n++) {
+		int block = _blockAlloc(d, 0);
+		if(block == -1) {
+			ret = -1;
+			break;
+		}
+		copies[n] = block;
+		ul2char(block, &desc[4*n]);
+	}
+
+	//a cópia é escrita como dados; só o superbloco, o bitmap e as
+	//referências passam pelo journal
+	for(unsigned int k = 0; k < _inodeTableSectors() && ret == 0; k++) {
+		unsigned int addr = copies[k / _sectorsPerBlock()] + k % _sectorsPerBlock();
+		journalForget(addr);
+		ret = _inodeReadSector(d, inodeAreaBeginSector() + k, sector);
+		if(ret == 0) ret = diskWriteSector(d, addr, sector);
+	}
+	if(ret == 0) {
+		journalForget(descBlock);
+		ret = diskWriteSector(d, descBlock, desc);
+	}
+	if(ret == 0) ret = _inodeTableRefBlocks(d, 1, MAX_INODES + 1);
+
+	if(ret == -1) {
+		for(unsigned int i = 0; i < n; i++) _bitMapSetBusyPerFree(copies[i]);
+		_bitMapSetBusyPerFree(descBlock);
+		return -1;
+	}
+	superblock.snapshots[id-1] = descBlock;
+	_superBlockDirty();
+	return 0;
+}
+
+//função que retorna o inode number na cópia em memória da área de inodes
+//usada por _fileFree, lendo o seu setor na primeira vez. retorna NULL
+//em caso de erro
+unsigned char* _batchInode(Disk* d, InodeBatch* b, unsigned int number)
+{
+	unsigned int k = (number - 1) / inodeNumInodesPerSector();
+	unsigned char* sector = &b->data[k * DISK_SECTORDATASIZE];
+	if(!(b->flags[k] & TABLE_LOADED)) {
+		if(_inodeReadSector(d, inodeAreaBeginSector() + k, sector) == -1) return NULL;
+		b->flags[k] |= TABLE_LOADED;
+	}
+	return &sector[(number - 1) % inodeNumInodesPerSector() * RAWINODE_WORDS * sizeof(unsigned int)];
+}
+
+//função que retorna a palavra w de um inode da cópia em memória
+unsigned int _batchWord(unsigned char* inode, unsigned int w)
+{
+	unsigned int value;
+	char2ul(&inode[4*w], &value);
+	return value;
+}
+
+//função que modifica a palavra w do inode number da cópia em memória
+void _batchSetWord(InodeBatch* b, unsigned char* inode, unsigned int number, unsigned int w, unsigned int value)
+{
+	ul2char(value, &inode[4*w]);
+	b->flags[(number - 1) / inodeNumInodesPerSector()] |= TABLE_DIRTY;
+}
+
+//função que deixa livre o inode number da cópia em memória: tudo zerado,
+//exceto o próprio número
+void _batchFree(InodeBatch* b, unsigned char* inode, unsigned int number)
+{
+	memset(inode, 0, RAWINODE_WORDS * sizeof(unsigned int));
+	_batchSetWord(b, inode, number, RAWINODE_NUMBER, number);
+	unsigned int group = _inodeGroup(number);
+	if(number < superblock.nextFreeInode[group]) superblock.nextFreeInode[group] = number;
+}
+
+//função que libera, em lote, as entradas do mapa de blocos de um arquivo a
+//partir do bloco keep (inclusive as reservadas além do tamanho) e as
+//extensões que deixam de ser necessárias ou ficam só com buracos no fim
+//da cadeia; com release diferente de 0, o próprio inode também fica
+//livre. a cadeia é lida do disco uma única vez, as referências aos
+//blocos são devolvidas em memória (o bitmap e as tabelas são gravados uma
+//vez, por _superBlockFlush) e cada setor de inodes alterado é gravado uma
+//única vez, em ordem crescente. cópias do inode em memória precisam ser
+//recarregadas. retorna 0 ou -1
+int _fileFree(Disk* d, unsigned int number, unsigned int keep, int release)
+{
+	InodeBatch b;
+	b.data = malloc(_inodeTableSectors() * DISK_SECTORDATASIZE);
+	b.flags = calloc(_inodeTableSectors(), 1);
+	if(b.data == NULL || b.flags == NULL) {
+		free(b.data);
+		free(b.flags);
+		return -1;
+	}
+
+	int ret = 0;
+	unsigned int first = 0, numBlocks = 0, numInodes = 0, steps = 0;
+	for(unsigned int n = number; n != 0 && ret == 0; steps++) {
+		unsigned char* inode = n <= MAX_INODES && steps < MAX_INODES ? _batchInode(d, &b, n) : NULL;
+		if(inode == NULL) {
+			ret = -1;
+			break;
+		}
+
+		unsigned int count = n == number ? inodeNumDirectBlocks() : inodeNumBlocksPerExtension();
+		for(unsigned int i = 0; i < count; i++) {
+			unsigned int entry = _batchWord(inode, i);
+			if(first + i < keep || entry == 0) continue;
+			if(_blockPut(BLOCKADDR(entry)) == -1) ret = -1;
+			_batchSetWord(&b, inode, n, i, 0);
+			numBlocks++;
+		}
+
+		unsigned int next = _batchWord(inode, RAWINODE_NEXT);
+		if(release || (n != number && first >= keep)) {
+			_batchFree(&b, inode, n);
+			numInodes++;
+		} else if(next != 0 && first + count >= keep) {
+			//as extensões seguintes só têm blocos liberados
+			_batchSetWord(&b, inode, n, RAWINODE_NEXT, 0);
+		}
+		first += count;
+		n = next;
+	}
+
+	//extensões mantidas que ficaram só com buracos no fim da cadeia também
+	//são liberadas: ainda ligadas e zeradas, pareceriam livres
+	if(ret == 0 && !release) {
+		unsigned int last = number;
+		for(unsigned int n = _batchWord(_batchInode(d, &b, number), RAWINODE_NEXT); n != 0; ) {
+			unsigned char* inode = _batchInode(d, &b, n);
+			for(unsigned int i = 0; i < inodeNumBlocksPerExtension(); i++) {
+				if(_batchWord(inode, i)) {
+					last = n;
+					break;
+				}
+			}
+			n = _batchWord(inode, RAWINODE_NEXT);
+		}
+
+		unsigned char* inode = _batchInode(d, &b, last);
+		unsigned int n = _batchWord(inode, RAWINODE_NEXT);
+		if(n != 0) _batchSetWord(&b, inode, last, RAWINODE_NEXT, 0);
+		while(n != 0) {
+			inode = _batchInode(d, &b, n);
+			unsigned int next = _batchWord(inode, RAWINODE_NEXT);
+			_batchFree(&b, inode, n);
+			numInodes++;
+			n = next;
+		}
+	}
+
+	for(unsigned int k = 0; k < _inodeTableSectors() && ret == 0; k++) {
+		if(b.flags[k] & TABLE_DIRTY) ret = _inodeWriteSector(d, inodeAreaBeginSector() + k, &b.data[k * DISK_SECTORDATASIZE]);
+	}
+	free(b.data);
+	free(b.flags);
+
+	//o bloco descomprimido em memória pode ter sido liberado
+	pthread_mutex_lock(&zLock);
+	superblock.zEntry = 0;
+	pthread_mutex_unlock(&zLock);
+	superblock.freeInodes += numInodes;
+	_superBlockDirty();
+	TRACE_DEBUG("free inode %u: %u blocos e %u inodes a partir do bloco %u", number, numBlocks, numInodes, keep);
+	return ret;
+}
+
+//função que inicializa o sistema de arquivos a partir do disco.
+//lê apenas o superbloco e coloca seus valores nas variáveis globais;
+//o bitmap é lido setor a setor quando usado e os diretórios, a partir
+//da raiz, são percorridos sob demanda
+int _initDirRoot(Disk* d)
+{
+	unsigned char diskSuperBlock[DISK_SECTORDATASIZE] = {0};
+
+	//lê o super bloco
+	if(diskReadSector(d,0,diskSuperBlock) == -1) return -1;
+
+	unsigned int magic, state;
+	char2ul(&diskSuperBlock[INDEX_MAGIC], &magic);
+	char2ul(&diskSuperBlock[INDEX_STATE], &state);
+	if(magic != MYFS_MAGIC) {
+		TRACE_ERROR("disco sem MyFS (identificador %08x)", magic);
+		return -1;
+	}
+
+	//após uma desmontagem correta o journal está vazio e não é percorrido.
+	//caso contrário, repete as transações que não chegaram às posições
+	//definitivas e relê o superbloco já atualizado
+	if(journalOpen(d, state != MYFS_STATE_CLEAN) == -1) return -1;
+	inodeSetSectorIO(_inodeReadSector, _inodeWriteSector);
+	if(state != MYFS_STATE_CLEAN && journalReadSector(d,0,diskSuperBlock) == -1) return -1;
+	
+	//passa os valores para as variáveis globais
+	char2ul(&diskSuperBlock[INDEX_TOTALBLOCKS], &superblock.totalBlocks);
+	char2ul(&diskSuperBlock[INDEX_BLOCKSIZE], &superblock.blockSize);
+	char2ul(&diskSuperBlock[INDEX_SECTOR_INIT], &superblock.sectorInit);
+	char2ul(&diskSuperBlock[INDEX_SIZE_BITMAP], &superblock.sizeBitMap);
+	char2ul(&diskSuperBlock[INDEX_BLOCK_ROOT], &superblock.blockRoot);
+	unsigned int bitMapSector, bitMapNumSectors, refCountSector, fingerprintSector;
+	char2ul(&diskSuperBlock[INDEX_BITMAP_SECTOR], &bitMapSector);
+	char2ul(&diskSuperBlock[INDEX_BITMAP_NUMSECTORS], &bitMapNumSectors);
+	char2ul(&diskSuperBlock[INDEX_REFCOUNT_SECTOR], &refCountSector);
+	char2ul(&diskSuperBlock[INDEX_FINGERPRINT_SECTOR], &fingerprintSector);
+	for(int i = 0; i < MAX_SNAPSHOTS; i++) {
+		char2ul(&diskSuperBlock[INDEX_SNAPSHOTS + 4*i], &superblock.snapshots[i]);
+	}
+	char2ul(&diskSuperBlock[INDEX_FREE_BLOCKS], &superblock.freeBlocks);
+	char2ul(&diskSuperBlock[INDEX_FREE_INODES], &superblock.freeInodes);
+	char2ul(&diskSuperBlock[INDEX_FLAGS], &superblock.flags);
+	char2ul(&diskSuperBlock[INDEX_NUM_GROUPS], &superblock.numGroups);
+	char2ul(&diskSuperBlock[INDEX_GROUP_SECTORS], &superblock.groupSectors);
+	char2ul(&diskSuperBlock[INDEX_GROUP_BLOCKS], &superblock.groupBlocks);
+	if(superblock.blockSize < DISK_SECTORDATASIZE) return -1;
+
+	//um journal menor que a maior operação (formatado por uma versão
+	//anterior) não confirmaria todas as operações inteiras
+	unsigned int journalSize = journalGetSize();
+	if(journalSize && journalSize < _journalSectors(d)) {
+		TRACE_ERROR("journal de %u setores, menor que os %u necessários: formate o disco de novo", journalSize, _journalSectors(d));
+		return -1;
+	}
+	if(!superblock.numGroups || superblock.numGroups > CG_MAX_GROUPS || (superblock.numGroups & (superblock.numGroups - 1))) return -1;
+	if(!superblock.groupBlocks || superblock.sizeBitMap != superblock.numGroups * superblock.groupBlocks) return -1;
+	if(bitMapNumSectors * BITS_PER_SECTOR < superblock.sizeBitMap) return -1;
+
+	//reserva o bitmap e a tabela de referências, mas não os lê
+	if(_tableInit(&superblock.bitMap, bitMapSector, bitMapNumSectors, 0) == -1) return -1;
+	if(_tableInit(&superblock.refCount, refCountSector, _refCountNumSectors(superblock.sizeBitMap), 0) == -1) return -1;
+	if(_tableInit(&superblock.fingerprints, fingerprintSector, _fingerprintNumSectors(superblock.sizeBitMap), 0) == -1) return -1;
+	superblock.zIn = superblock.zOut = 0;
+	superblock.dedupHits = 0;
+	superblock.defragNext = 1;
+	superblock.defragBlock = superblock.defragIdle = 0;
+	superblock.dirty = 0;
+	_groupsInit();
+	superblock.disk = d;
+	inodeSetMaxNumber(MAX_INODES);
+
+	//enquanto montado o disco fica marcado como não desmontado. a marca
+	//vai direto para a posição definitiva, pois o journal está vazio
+	if(state == MYFS_STATE_CLEAN) {
+		ul2char(MYFS_STATE_MOUNTED, &diskSuperBlock[INDEX_STATE]);
+		if(diskWriteSector(d, 0, diskSuperBlock) == -1) return -1;
+	}
+	superblock.state = MYFS_STATE_MOUNTED;
+	TRACE_INFO("montado: %u blocos de %u bytes, %u livres, %u inodes livres%s", superblock.sizeBitMap,
+		superblock.blockSize, superblock.freeBlocks, superblock.freeInodes, state == MYFS_STATE_CLEAN ? "" : " (journal repetido)");
+	TRACE_EVENT(TRACE_OP_MOUNT, 0, state);
+
+	dcacheInit();
+
+	return 0;
+}
+
+//função que descarta o estado em memória do sistema de arquivos,
+//forçando uma nova leitura do disco na próxima abertura
+void _releaseDirRoot(void)
+{
+	journalClose();
+	_tableRelease(&superblock.bitMap);
+	_tableRelease(&superblock.refCount);
+	_tableRelease(&superblock.fingerprints);
+	free(superblock.dedupSlots);
+	superblock.dedupSlots = NULL;
+	superblock.dedupSize = superblock.dedupUsed = 0;
+	free(superblock.zBlock);
+	free(superblock.zData);
+	superblock.zBlock = superblock.zData = NULL;
+	superblock.zEntry = 0;
+	superblock.dirty = 0;
+	superblock.disk = NULL;
+	_bcacheInvalidateAll();
+	dcacheInit();
+}
+
+//função que cria o diretório raiz
+//cria um bloco de dados correspondente ao 
+//primeiro bloco livre do disco e salva o inode
+//retorna o numero do bloco caso de sucesso
+//e -1 caso contrário
+int _createDirRoot(Disk* d)
+{
+	Inode* root = inodeLoad(ID_INODE_DEFAULT, d);
+	if(root == NULL) return -1;
+
+	inodeSetFileType(root, FILETYPE_DIR);
+	inodeSetRefCount(root, 1);
+	int blockRoot = _dirInitBlock(d, root, ID_INODE_DEFAULT);
+	free(root);
+
+	return blockRoot;
+}
+
+//função que acrescenta uma página à tabela de descritores, colocando as
+//novas entradas na lista de livres. as páginas existentes não mudam de
+//lugar, o que permite a consulta sem lock. retorna 0 ou -1 se faltar
+//memória ou a tabela estiver cheia
+int _fdTableGrow(void)
+{
+	unsigned int page = fdTable.size / FD_PAGE_SIZE;
+	if(page >= FD_MAX_PAGES) return -1;
+	FileDescriptor* entries = calloc(FD_PAGE_SIZE, sizeof(FileDescriptor));
+	if(entries == NULL) return -1;
+
+	//empilha do fim para o início para que os menores índices saiam primeiro
+	for(int i = FD_PAGE_SIZE - 1; i >= 0; i--) {
+		pthread_rwlock_init(&entries[i].lock, NULL);
+		entries[i].nextFree = fdTable.freeList;
+		fdTable.freeList = fdTable.size + i;
+	}
+	fdTable.pages[page] = entries;
+	__atomic_store_n(&fdTable.size, fdTable.size + FD_PAGE_SIZE, __ATOMIC_RELEASE);
+	return 0;
+}
+
+//função que dobra a quantidade de baldes da tabela de arquivos abertos
+int _openFileRehash(void)
+{
+	unsigned int numBuckets = fdTable.numBuckets ? fdTable.numBuckets*2 : OPEN_FILES_BUCKETS_INITIAL;
+	OpenFile** buckets = calloc(numBuckets, sizeof(OpenFile*));
+	if(buckets == NULL) return -1;
+
+	for(unsigned int i = 0; i < fdTable.numBuckets; i++) {
+		OpenFile* f = fdTable.buckets[i];
+		while(f != NULL) {
+			OpenFile* next = f->hashNext;
+			f->hashNext = buckets[f->number % numBuckets];
+			buckets[f->number % numBuckets] = f;
+			f = next;
+		}
+	}
+	free(fdTable.buckets);
+	fdTable.buckets = buckets;
+	fdTable.numBuckets = numBuckets;
+	return 0;
+}
+
+//função que registra um inode recém carregado como arquivo aberto
+//retorna o arquivo aberto (com uma referência) ou NULL
+OpenFile* _openFileInsert(Inode* inode)
+{
+	if(fdTable.numOpenFiles >= fdTable.numBuckets && _openFileRehash() == -1) return NULL;
+
+	OpenFile* f = malloc(sizeof(OpenFile));
+	if(f == NULL) return NULL;
+	f->inode = inode;
+	f->number = inodeGetNumber(inode);
+	f->type = inodeGetFileType(inode);
+	f->view = view.id;
+	f->refCount = 1;
+	pthread_rwlock_init(&f->lock, NULL);
+	f->hashNext = fdTable.buckets[f->number % fdTable.numBuckets];
+	fdTable.buckets[f->number % fdTable.numBuckets] = f;
+	fdTable.numOpenFiles++;
+	return f;
+}
+
+//função que devolve uma referência de um arquivo aberto, liberando-o
+//quando nenhum descritor o usa mais
+void _openFilePut(OpenFile* f)
+{
+	if(--f->refCount > 0) return;
+
+	OpenFile** link = &fdTable.buckets[f->number % fdTable.numBuckets];
+	while(*link != f) link = &(*link)->hashNext;
+	*link = f->hashNext;
+	fdTable.numOpenFiles--;
+
+	pthread_rwlock_destroy(&f->lock);
+	free(f->inode);
+	free(f);
+}
+
+//função que ocupa um descritor livre para o arquivo aberto dado
+//retorna o descritor ou -1 caso não haja memória
+int _fdAlloc(OpenFile* file)
+{
+	if(fdTable.freeList == -1 && _fdTableGrow() == -1) return -1;
+
+	int index = fdTable.freeList;
+	FileDescriptor* f = &fdTable.pages[index / FD_PAGE_SIZE][index % FD_PAGE_SIZE];
+	fdTable.freeList = f->nextFree;
+
+	//o descritor só é visto aberto depois de inicializado
+	f->cursor = 0;
+	__atomic_store_n(&f->file, file, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&fdTable.openCount, 1, __ATOMIC_RELEASE);
+
+	return index+1;
+}
+
+//função que verifica se os n bytes de buf são todos zero
+int _bufIsZero(const char* buf, unsigned int n)
+{
+	for(unsigned int i = 0; i < n; i++) {
+		if(buf[i]) return 0;
+	}
+	return 1;
+}
+
+//função que lê n bytes a partir da posição off do bloco de dados addr.
+//setores inteiros vão direto para buf
+int _dataRead(Disk* d, unsigned int addr, unsigned int off, unsigned char* buf, unsigned int n)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	for(unsigned int pos = off; pos < off + n; ) {
+		unsigned int s = pos / DISK_SECTORDATASIZE;
+		unsigned int sectorOff = pos % DISK_SECTORDATASIZE;
+		unsigned int len = DISK_SECTORDATASIZE - sectorOff;
+		if(len > off + n - pos) len = off + n - pos;
+
+		if(len == DISK_SECTORDATASIZE) {
+			if(diskReadSector(d, addr + s, &buf[pos - off]) == -1) return -1;
+		} else {
+			if(diskReadSector(d, addr + s, sector) == -1) return -1;
+			memcpy(&buf[pos - off], &sector[sectorOff], len);
+		}
+		pos += len;
+	}
+	return 0;
+}
+
+//função que escreve n bytes de buf a partir da posição off do bloco de
+//dados addr. setores escritos em parte são lidos antes; em um bloco novo
+//(fresh) não há o que ler e os setores fora do trecho são zerados
+int _dataWrite(Disk* d, unsigned int addr, unsigned int off, const unsigned char* buf, unsigned int n, int fresh)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int end = off + n;
+	_bcacheInvalidate(addr);
+	for(unsigned int s = fresh ? 0 : off / DISK_SECTORDATASIZE; s < _sectorsPerBlock(); s++) {
+		unsigned int start = s * DISK_SECTORDATASIZE;
+		if(!fresh && start >= end) break;
+
+		//um bloco novo pode ter sido um bloco de metadados, ainda com
+		//versões pendentes no journal
+		if(fresh) journalForget(addr + s);
+
+		unsigned int a = off > start ? off : start;
+		unsigned int b = end < start + DISK_SECTORDATASIZE ? end : start + DISK_SECTORDATASIZE;
+		if(a == start && b == start + DISK_SECTORDATASIZE) {
+			if(diskWriteSector(d, addr + s, (unsigned char*) &buf[start - off]) == -1) return -1;
+			continue;
+		}
+
+		if(fresh) memset(sector, 0, DISK_SECTORDATASIZE);
+		else if(diskReadSector(d, addr + s, sector) == -1) return -1;
+		if(a < b) memcpy(&sector[a - start], &buf[a - off], b - a);
+		if(diskWriteSector(d, addr + s, sector) == -1) return -1;
+	}
+	return 0;
+}
+
+//função que escreve n bytes de buf a partir de off no bloco blockNum de um
+//inode, reservado e ainda não escrito (entrada entry no mapa). os dados
+//vão para o lugar reservado, sem compressão nem deduplicação, com o
+//restante do bloco zerado; um bloco reservado compartilhado com snapshots
+//ou clones dá lugar a um bloco novo. zeros não precisam ser escritos.
+//retorna 0 ou -1
+int _unwrittenWrite(Disk* d, Inode* inode, unsigned int blockNum, unsigned int entry,
+	unsigned int off, const unsigned char* buf, unsigned int n)
+{
+	if(_bufIsZero((const char*) buf, n)) return 0;
+
+	unsigned int addr = BLOCKADDR(entry);
+	int refs = _blockRefs(addr);
+	if(refs == -1) return -1;
+	int target = refs > 0 ? _blockAlloc(d, inodeGetNumber(inode)) : (int) addr;
+	if(target == -1) return -1;
+
+	if(_dataWrite(d, target, off, buf, n, 1) == -1 || _inodeSetBlock(inode, blockNum, target) == -1) {
+		if(refs > 0) _bitMapSetBusyPerFree(target);
+		return -1;
+	}
+	if(refs > 0) _blockPut(addr);
+	return 0;
+}
+
+//função que calcula a impressão digital (FNV-1a) do conteúdo de um bloco.
+//nunca retorna 0, que marca os blocos fora do índice
+unsigned int _fingerprint(const unsigned char* block)
+{
+	unsigned int h = 2166136261u;
+	for(unsigned int i = 0; i < superblock.blockSize; i++) h = (h ^ block[i]) * 16777619u;
+	return h ? h : 1;
+}
+
+//função que acrescenta ao índice em memória o bloco de índice index com a
+//impressão fp. pares cujo bloco mudou de impressão estão desatualizados e
+//são reaproveitados
+int _dedupInsert(unsigned int fp, unsigned int index)
+{
+	unsigned int mask = superblock.dedupSize - 1;
+	for(unsigned int i = fp & mask; ; i = (i + 1) & mask) {
+		unsigned int* slot = &superblock.dedupSlots[2*i];
+		unsigned int cur = 0;
+		if(slot[1] && _fingerprintGet(slot[1] - 1, &cur) == -1) return -1;
+		if(slot[1] && slot[0] == cur) {
+			if(slot[0] == fp && slot[1] == index + 1) return 0;
+			continue;
+		}
+		if(!slot[1]) superblock.dedupUsed++;
+		slot[0] = fp;
+		slot[1] = index + 1;
+		return 0;
+	}
+}
+
+//função que (re)monta o índice em memória a partir da tabela de impressões
+//digitais, descartando os pares desatualizados
+int _dedupBuild(void)
+{
+	unsigned int size = 64;
+	while(size < 2 * superblock.sizeBitMap) size *= 2;
+	free(superblock.dedupSlots);
+	superblock.dedupSlots = calloc(size, 2 * sizeof(unsigned int));
+	superblock.dedupSize = superblock.dedupSlots ? size : 0;
+	superblock.dedupUsed = 0;
+	if(superblock.dedupSlots == NULL) return -1;
+
+	for(unsigned int b = 0; b < superblock.sizeBitMap; b++) {
+		unsigned int fp;
+		if(_fingerprintGet(b, &fp) == -1) return -1;
+		if(fp && _dedupInsert(fp, b) == -1) return -1;
+	}
+	return 0;
+}
+
+//função que registra a impressão fp do bloco de índice index na tabela e,
+//se já montado, no índice em memória
+int _dedupAdd(unsigned int fp, unsigned int index)
+{
+	if(_fingerprintSet(index, fp) == -1) return -1;
+	if(!fp || superblock.dedupSlots == NULL) return 0;
+	if(superblock.dedupUsed >= superblock.dedupSize / 4 * 3) return _dedupBuild();
+	return _dedupInsert(fp, index);
+}
+
+//função que procura um bloco de dados com o mesmo conteúdo de block,
+//de impressão fp, conferindo byte a byte os candidatos. retorna o endereço
+//do bloco, 0 se não houver nenhum ou -1
+int _dedupFind(Disk* d, const unsigned char* block, unsigned int fp)
+{
+	if(superblock.dedupSlots == NULL && _dedupBuild() == -1) return -1;
+
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int mask = superblock.dedupSize - 1;
+	for(unsigned int i = fp & mask; superblock.dedupSlots[2*i+1]; i = (i + 1) & mask) {
+		unsigned int* slot = &superblock.dedupSlots[2*i];
+		unsigned int cur;
+		if(slot[0] != fp || _fingerprintGet(slot[1] - 1, &cur) == -1 || cur != fp) continue;
+
+		unsigned int addr = _blockAddr(slot[1] - 1);
+		if(_blockRefs(addr) >= REFCOUNT_MAX) continue;
+		unsigned int s = 0;
+		for(; s < _sectorsPerBlock(); s++) {
+			if(diskReadSector(d, addr + s, sector) == -1) return -1;
+			if(memcmp(sector, &block[s * DISK_SECTORDATASIZE], DISK_SECTORDATASIZE) != 0) break;
+		}
+		if(s == _sectorsPerBlock()) return addr;
+	}
+	return 0;
+}
+
+//função que grava um bloco inteiro, block, como bloco blockNum de um inode
+//de entrada addr no mapa (sem compressão). um bloco de zeros vira um
+//buraco e um bloco igual a outro já gravado passa a compartilhá-lo; os
+//demais são gravados e entram no índice. retorna 0 ou -1
+int _dedupWrite(Disk* d, Inode* inode, unsigned int blockNum, unsigned int addr, const unsigned char* block)
+{
+	if(_bufIsZero((const char*) block, superblock.blockSize)) {
+		if(addr && (_inodeSetBlock(inode, blockNum, 0) == -1 || _blockPut(addr) == -1)) return -1;
+		if(addr && blockNum >= inodeNumDirectBlocks() && _inodeTrim(inode) == -1) return -1;
+		return 0;
+	}
+
+	unsigned int fp = _fingerprint(block);
+	int dup = _dedupFind(d, block, fp);
+	if(dup == -1) return -1;
+	if(dup) {
+		superblock.dedupHits++;
+		if((unsigned int) dup == addr) return 0;
+		if(_blockGet(dup) == -1) return -1;
+		if(_inodeSetBlock(inode, blockNum, dup) == -1) {
+			_blockPut(dup);
+			return -1;
+		}
+		return addr ? _blockPut(addr) : 0;
+	}
+
+	//blocos compartilhados com snapshots ou clones não são alterados
+	int refs = addr ? _blockRefs(addr) : 0;
+	if(refs == -1) return -1;
+	int fresh = addr == 0 || refs > 0;
+	int target = fresh ? _blockAlloc(d, inodeGetNumber(inode)) : (int) addr;
+	if(target == -1) return -1;
+	if(_dataWrite(d, target, 0, block, superblock.blockSize, fresh) == -1 ||
+		(fresh && _inodeSetBlock(inode, blockNum, target) == -1)) {
+		if(fresh) _bitMapSetBusyPerFree(target);
+		return -1;
+	}
+	if(refs > 0) _blockPut(addr);
+
+	//o índice só evita gravações futuras: uma falha nele não desfaz esta
+	_dedupAdd(fp, _blockIndex(target));
+	return 0;
+}
+
+//função que retorna quantos cilindros a leitura sequencial dos blocos from
+//a end - 1 de um arquivo cruza. addrs, se não for NULL, substitui os
+//endereços do mapa a partir do bloco from (0 mantém o do mapa)
+unsigned long _fileCylinders(Disk* d, Inode* inode, const unsigned int* addrs, unsigned int from, unsigned int end)
+{
+	unsigned long crossed = 0, cyl, prev = 0;
+	int first = 1;
+	for(unsigned int b = from; b < end; b++) {
+		unsigned int addr = addrs && addrs[b - from] ? addrs[b - from] : BLOCKADDR(inodeGetBlockAddr(inode, b));
+		if(!addr || diskAddrToCylinder(d, addr, &cyl) == -1) continue;
+		if(!first) crossed += cyl > prev ? cyl - prev : prev - cyl;
+		prev = cyl;
+		first = 0;
+	}
+	return crossed;
+}
+
+//função que move os blocos first a end - 1 de um arquivo regular para a
+//sequência contígua de blocos livres escolhida no início do arquivo, se a
+//leitura do arquivo inteiro cruzar menos cilindros com os blocos nela. o
+//próximo destino fica em superblock.defragRun, entre os passos. blocos
+//compartilhados ficam onde estão. a troca do mapa de cada trecho é uma
+//única transação do journal. *next recebe o bloco em que o arquivo
+//continua (a quantidade de blocos, se terminou ou foi deixado como está).
+//retorna a quantidade de blocos movidos ou -1
+int _defragFile(Disk* d, Inode* inode, unsigned int first, unsigned int end, unsigned int* next, MyFSDefragStat* st)
+{
+	unsigned int numBlocks = _inodeNumBlocks(inode);
+	*next = numBlocks;
+	if(first == 0) {
+		unsigned int* addrs = calloc(numBlocks ? numBlocks : 1, sizeof(unsigned int));
+		if(addrs == NULL) return -1;
+
+		//escolhe o destino de cada bloco que pode ser movido, de
+		//preferência no grupo de cilindros do inode
+		unsigned int count = 0;
+		for(unsigned int b = 0; b < numBlocks; b++) {
+			unsigned int addr = BLOCKADDR(inodeGetBlockAddr(inode, b));
+			if(addr && _blockRefs(addr) == 0) addrs[b] = ++count;
+		}
+		unsigned int group = _inodeGroup(inodeGetNumber(inode));
+		int run = count ? _bitMapFindRun(count, group * superblock.groupBlocks) : -1;
+		if(run != -1) {
+			for(unsigned int b = 0; b < numBlocks; b++) {
+				if(addrs[b]) addrs[b] = _blockAddr(run + addrs[b] - 1);
+			}
+			if(_fileCylinders(d, inode, addrs, 0, numBlocks) >= _fileCylinders(d, inode, NULL, 0, numBlocks)) run = -1;
+		}
+		free(addrs);
+		if(run == -1) return 0;
+		superblock.defragRun = run;
+	}
+
+	unsigned int from = first ? first - 1 : 0;
+	unsigned long before = _fileCylinders(d, inode, NULL, from, end);
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int moved = 0, b;
+	int ret = 0;
+	superblock.zEntry = 0;
+	journalBegin();
+	for(b = first; b < end && ret == 0; b++) {
+		unsigned int entry = inodeGetBlockAddr(inode, b);
+		unsigned int old = BLOCKADDR(entry);
+		if(!old || _blockRefs(old) != 0) continue;
+
+		//um destino ocupado desde o início do arquivo encerra o arquivo
+		unsigned int index = superblock.defragRun;
+		unsigned char* byte = index < superblock.sizeBitMap ? _tableByte(&superblock.bitMap, index / 8) : NULL;
+		if(byte == NULL || (*byte & (1 << (index % 8)))) break;
+		unsigned int target = _blockAddr(index);
+		unsigned int numSectors = BLOCKADDR_ZSECTORS(entry) ? BLOCKADDR_ZSECTORS(entry) : _sectorsPerBlock();
+		unsigned int fp;
+
+		//copia os dados e só então troca o endereço no mapa
+		if(_bitMapSetFreePerBusy(target) == -1) ret = -1;
+		for(unsigned int s = 0; s < numSectors && ret == 0; s++) {
+			journalForget(target + s);
+			if(diskReadSector(d, old + s, sector) == -1 || diskWriteSector(d, target + s, sector) == -1) ret = -1;
+		}
+		if(ret == 0 && _inodeSetBlock(inode, b, target | (entry & ~BLOCKADDR_MASK)) == -1) ret = -1;
+		if(ret == -1) {
+			_bitMapSetBusyPerFree(target);
+			break;
+		}
+
+		//a impressão digital acompanha o conteúdo
+		if(_fingerprintGet(_blockIndex(old), &fp) == 0 && fp) _dedupAdd(fp, _blockIndex(target));
+		_blockPut(old);
+		superblock.defragRun++;
+		moved++;
+	}
+	if(_superBlockFlush(d) == -1) ret = -1;
+	journalEnd();
+	if(b == end && end < numBlocks) *next = end;
+
+	if(moved) {
+		st->filesMoved++;
+		st->blocksMoved += moved;
+		st->cylindersBefore += before;
+		st->cylindersAfter += _fileCylinders(d, inode, NULL, from, end);
+	}
+	TRACE_DEBUG("defrag inode %u, blocos %u a %u: %u movidos", inodeGetNumber(inode), first, end, moved);
+	return ret == 0 ? (int) moved : -1;
+}
+
+//função que retorna o inode number de uma cópia da área de inodes
+unsigned int* _checkInode(unsigned int* table, unsigned int number)
+{
+	return &table[(number - 1) * RAWINODE_WORDS];
+}
+
+//função que indica se o inode number de uma cópia da área de inodes é o
+//primeiro da cadeia de um arquivo ou diretório
+int _checkIsHead(unsigned int* table, unsigned int number)
+{
+	unsigned int type = _checkInode(table, number)[RAWINODE_TYPE];
+	return type == FILETYPE_REGULAR || type == FILETYPE_DIR;
+}
+
+//função que retorna o índice no bitmap do bloco de uma entrada do mapa,
+//ou -1 se ela não aponta para o início de um bloco de dados. blocos de
+//diretório (metadata) não podem estar comprimidos
+int _checkBlockIndex(unsigned int entry, int metadata)
+{
+	unsigned int addr = BLOCKADDR(entry);
+	unsigned int zSectors = BLOCKADDR_ZSECTORS(entry);
+	if(zSectors > _sectorsPerBlock() || (metadata && (zSectors || (entry & BLOCKADDR_UNWRITTEN)))) return -1;
+	if(zSectors && (entry & BLOCKADDR_UNWRITTEN)) return -1;
+	if(addr < superblock.sectorInit) return -1;
+
+	unsigned int off = addr - superblock.sectorInit;
+	unsigned int group = off / superblock.groupSectors;
+	off %= superblock.groupSectors;
+	if(group >= superblock.numGroups || off < _inodeSliceSectors()) return -1;
+	off -= _inodeSliceSectors();
+	if(off % _sectorsPerBlock() || off / _sectorsPerBlock() >= superblock.groupBlocks) return -1;
+	return group * superblock.groupBlocks + off / _sectorsPerBlock();
+}
+
+//função que retorna a entrada b do mapa de blocos do inode number de uma
+//cópia da área de inodes, seguindo as extensões, ou NULL se a cadeia
+//terminar antes
+unsigned int* _checkMapEntry(unsigned int* table, unsigned int number, unsigned int b)
+{
+	unsigned int* inode = _checkInode(table, number);
+	if(b < inodeNumDirectBlocks()) return &inode[b];
+	b -= inodeNumDirectBlocks();
+	for(unsigned int steps = 0; steps < MAX_INODES; steps++) {
+		unsigned int next = inode[RAWINODE_NEXT];
+		if(next < 1 || next > MAX_INODES) return NULL;
+		inode = _checkInode(table, next);
+		if(b < inodeNumBlocksPerExtension()) return &inode[b];
+		b -= inodeNumBlocksPerExtension();
+	}
+	return NULL;
+}
+
+//função que deixa livre, em memória, o inode number
+void _checkClear(Check* c, unsigned int number)
+{
+	unsigned int* inode = _checkInode(c->inodes, number);
+	memset(inode, 0, RAWINODE_WORDS * sizeof(unsigned int));
+	inode[RAWINODE_NUMBER] = number;
+	c->inodeDirty[number] = 1;
+	c->owner[number] = 0;
+}
+
+//função que deixa livres, em memória, um inode e as suas extensões
+void _checkRelease(Check* c, unsigned int number)
+{
+	for(unsigned int steps = 0; number >= 1 && number <= MAX_INODES && steps < MAX_INODES; steps++) {
+		unsigned int next = _checkInode(c->inodes, number)[RAWINODE_NEXT];
+		_checkClear(c, number);
+		number = next;
+	}
+}
+
+//função que lê, na ordem do disco, as tabelas do superbloco, a área de
+//inodes e as cópias dela guardadas nos snapshots, contando em refs os
+//blocos que guardam as cópias. retorna 0 ou -1
+int _checkReadInodes(Disk* d, Check* c, unsigned short* refs, MyFSCheckStat* st)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+
+	//o bitmap e as tabelas ficam inteiros em memória
+	SectorTable* tables[] = { &superblock.bitMap, &superblock.refCount, &superblock.fingerprints };
+	for(unsigned int t = 0; t < 3; t++) {
+		for(unsigned int s = 0; s < tables[t]->numSectors; s++) {
+			if(_tableLoadSector(tables[t], s) == -1) return -1;
+		}
+	}
+
+	//os setores lógicos da área de inodes estão em ordem crescente no disco
+	for(unsigned int k = 0; k < _inodeTableSectors(); k++) {
+		if(_inodeReadSector(d, inodeAreaBeginSector() + k, sector) == -1) return -1;
+		for(unsigned int w = 0; w < DISK_SECTORDATASIZE / sizeof(unsigned int); w++) {
+			char2ul(&sector[4*w], &c->inodes[k * DISK_SECTORDATASIZE / sizeof(unsigned int) + w]);
+		}
+	}
+
+	for(unsigned int id = 0; id < MAX_SNAPSHOTS; id++) {
+		if(!superblock.snapshots[id]) continue;
+		unsigned int copies[DISK_SECTORDATASIZE/sizeof(unsigned int)];
+		unsigned int numCopies = (_inodeTableSectors() + _sectorsPerBlock() - 1) / _sectorsPerBlock();
+		int ok = _checkBlockIndex(superblock.snapshots[id], 1) != -1 &&
+			diskReadSector(d, superblock.snapshots[id], sector) == 0;
+		for(unsigned int i = 0; ok && i < numCopies; i++) {
+			char2ul(&sector[4*i], &copies[i]);
+			if(_checkBlockIndex(copies[i], 1) == -1) ok = 0;
+		}
+		if(ok && (c->snapInodes[id] = malloc(MAX_INODES * RAWINODE_WORDS * sizeof(unsigned int))) == NULL) return -1;
+		for(unsigned int k = 0; ok && k < _inodeTableSectors(); k++) {
+			if(diskReadSector(d, copies[k / _sectorsPerBlock()] + k % _sectorsPerBlock(), sector) == -1) return -1;
+			for(unsigned int w = 0; w < DISK_SECTORDATASIZE / sizeof(unsigned int); w++) {
+				char2ul(&sector[4*w], &c->snapInodes[id][k * DISK_SECTORDATASIZE / sizeof(unsigned int) + w]);
+			}
+		}
+		if(!ok) {
+			TRACE_WARN("fsck: snapshot %u com descritor inválido", id + 1);
+			free(c->snapInodes[id]);
+			c->snapInodes[id] = NULL;
+			st->unrepairable++;
+			continue;
+		}
+		refs[_checkBlockIndex(superblock.snapshots[id], 1)]++;
+		for(unsigned int i = 0; i < numCopies; i++) refs[_checkBlockIndex(copies[i], 1)]++;
+	}
+	return 0;
+}
+
+//função que confere as cadeias de extensões da área de inodes: cada
+//extensão pertence a um único inode e inodes que não são livres pertencem
+//a alguma cadeia. cadeias inválidas são cortadas e inodes perdidos zerados
+void _checkChains(Check* c, MyFSCheckStat* st)
+{
+	for(unsigned int n = 1; n <= MAX_INODES; n++) {
+		if(_checkIsHead(c->inodes, n)) c->owner[n] = n;
+	}
+	for(unsigned int n = 1; n <= MAX_INODES; n++) {
+		if(c->owner[n] != n) continue;
+		unsigned int prev = n;
+		for(unsigned int next = _checkInode(c->inodes, n)[RAWINODE_NEXT]; next; next = _checkInode(c->inodes, next)[RAWINODE_NEXT]) {
+			if(next > MAX_INODES || c->owner[next]) {
+				TRACE_WARN("fsck: inode %u com extensão %u inválida", n, next);
+				st->badChains++;
+				_checkInode(c->inodes, prev)[RAWINODE_NEXT] = 0;
+				c->inodeDirty[prev] = 1;
+				break;
+			}
+			c->owner[next] = n;
+			prev = next;
+		}
+	}
+	for(unsigned int n = 1; n <= MAX_INODES; n++) {
+		if(c->owner[n]) continue;
+		unsigned int* inode = _checkInode(c->inodes, n);
+		for(unsigned int w = 0; w < RAWINODE_WORDS; w++) {
+			if(w == RAWINODE_NUMBER || !inode[w]) continue;
+			TRACE_WARN("fsck: inode %u perdido", n);
+			st->badChains++;
+			_checkClear(c, n);
+			break;
+		}
+	}
+}
+
+//função que lista os blocos dos diretórios. um diretório termina no seu
+//primeiro bloco sem endereço válido ou já usado por outro diretório.
+//retorna 0 ou -1
+int _checkDirBlocks(Check* c, MyFSCheckStat* st)
+{
+	unsigned char* used = calloc(superblock.sizeBitMap, 1);
+	unsigned int max = 0;
+	if(used == NULL) return -1;
+
+	for(unsigned int n = 1; n <= MAX_INODES; n++) {
+		unsigned int* inode = _checkInode(c->inodes, n);
+		if(c->owner[n] != n || inode[RAWINODE_TYPE] != FILETYPE_DIR) continue;
+
+		unsigned int numBlocks = inode[RAWINODE_SIZE] / superblock.blockSize;
+		c->dirFirst[n] = c->numDirBlocks;
+		for(unsigned int b = 0; b < numBlocks; b++) {
+			unsigned int* entry = _checkMapEntry(c->inodes, n, b);
+			int index = entry && *entry ? _checkBlockIndex(*entry, 1) : -1;
+			if(index == -1 || used[index]) {
+				numBlocks = b;
+				break;
+			}
+			used[index] = 1;
+			if(c->numDirBlocks == max) {
+				max = max ? 2 * max : 64;
+				unsigned int* addrs = realloc(c->dirAddrs, max * sizeof(unsigned int));
+				if(addrs == NULL) {
+					free(used);
+					return -1;
+				}
+				c->dirAddrs = addrs;
+			}
+			c->dirAddrs[c->numDirBlocks++] = BLOCKADDR(*entry);
+		}
+		c->dirCount[n] = numBlocks;
+
+		//o tamanho de um diretório é sempre um múltiplo do bloco
+		if(inode[RAWINODE_SIZE] != numBlocks * superblock.blockSize) {
+			TRACE_WARN("fsck: diretório %u com tamanho %u inválido", n, inode[RAWINODE_SIZE]);
+			st->badBlockAddrs++;
+			inode[RAWINODE_SIZE] = numBlocks * superblock.blockSize;
+			c->inodeDirty[n] = 1;
+		}
+	}
+	free(used);
+	return 0;
+}
+
+//função que compara endereços de blocos de diretório para qsort
+int _checkCompareAddr(const void* a, const void* b)
+{
+	unsigned int x = **(unsigned int* const*) a, y = **(unsigned int* const*) b;
+	return x < y ? -1 : x > y;
+}
+
+//função que lê os blocos de diretório em ordem crescente de endereço.
+//retorna 0 ou -1
+int _checkReadDirs(Disk* d, Check* c)
+{
+	unsigned int n = c->numDirBlocks;
+	unsigned int** order = malloc((n ? n : 1) * sizeof(unsigned int*));
+	c->dirData = malloc((size_t) (n ? n : 1) * superblock.blockSize);
+	c->dirDirty = calloc(n ? n : 1, 1);
+	if(order == NULL || c->dirData == NULL || c->dirDirty == NULL) {
+		free(order);
+		return -1;
+	}
+
+	for(unsigned int k = 0; k < n; k++) order[k] = &c->dirAddrs[k];
+	qsort(order, n, sizeof(unsigned int*), _checkCompareAddr);
+	for(unsigned int i = 0; i < n; i++) {
+		unsigned int k = order[i] - c->dirAddrs;
+		for(unsigned int s = 0; s < _sectorsPerBlock(); s++) {
+			unsigned char* sector = &c->dirData[(size_t) k * superblock.blockSize + s * DISK_SECTORDATASIZE];
+			if(journalReadSector(d, c->dirAddrs[k] + s, sector) == -1) {
+				free(order);
+				return -1;
+			}
+		}
+	}
+	free(order);
+	return 0;
+}
+
+//função que guarda uma entrada de diretório encontrada por uma thread.
+//retorna 0 ou -1 se faltar memória
+int _checkAddEntry(CheckWorker* w, unsigned int dir, unsigned int target, unsigned int pos)
+{
+	if(w->numEntries == w->maxEntries) {
+		unsigned int max = w->maxEntries ? 2 * w->maxEntries : 256;
+		CheckEntry* entries = realloc(w->entries, max * sizeof(CheckEntry));
+		if(entries == NULL) return -1;
+		w->entries = entries;
+		w->maxEntries = max;
+	}
+	w->entries[w->numEntries].dir = dir;
+	w->entries[w->numEntries].target = target;
+	w->entries[w->numEntries].pos = pos;
+	w->numEntries++;
+	return 0;
+}
+
+//função que confere os registros de um setor do diretório dir, na
+//posição pos dos blocos lidos. first indica o primeiro setor do
+//diretório, que começa com "." e "..". registros corrompidos são
+//descartados
+int _checkDirSector(CheckWorker* w, unsigned int dir, unsigned int k, unsigned int pos, int first)
+{
+	Check* c = w->c;
+	unsigned char* sector = &c->dirData[pos];
+	int dot = 0;
+
+	for(unsigned int off = 0, prev = 0; off < DISK_SECTORDATASIZE; prev = off, off += _dirEntryRecLen(sector, off)) {
+		//um registro que não cabe no setor termina o anterior
+		if(off + DIRENTRY_HEADER > DISK_SECTORDATASIZE) {
+			w->st.badEntries++;
+			_dirEntrySetRecLen(sector, prev, DISK_SECTORDATASIZE - prev);
+			c->dirDirty[k] = 1;
+			break;
+		}
+		unsigned int recLen = _dirEntryRecLen(sector, off);
+		if(recLen < DIRENTRY_HEADER || recLen % 4 || off + recLen > DISK_SECTORDATASIZE) {
+			TRACE_WARN("fsck: diretório %u com registro inválido no byte %u", dir, pos + off);
+			w->st.badEntries++;
+			_dirEntrySetRecLen(sector, off, DISK_SECTORDATASIZE - off);
+			ul2char(0, &sector[off+DIRENTRY_INODE]);
+			c->dirDirty[k] = 1;
+			continue;
+		}
+
+		unsigned int number, nameLen = sector[off+DIRENTRY_NAMELEN];
+		char2ul(&sector[off+DIRENTRY_INODE], &number);
+		if(!number) continue;
+		w->st.dirEntries++;
+		const char* name = (const char*) &sector[off+DIRENTRY_HEADER];
+		int isDot = nameLen == 1 && name[0] == '.';
+		int isDotDot = nameLen == 2 && name[0] == '.' && name[1] == '.';
+
+		if(first && off == 0 && isDot) {
+			dot = 1;
+			if(number != dir) {
+				w->st.badEntries++;
+				ul2char(dir, &sector[off+DIRENTRY_INODE]);
+				c->dirDirty[k] = 1;
+			}
+			continue;
+		}
+		if(first && off == DIRENTRY_SIZE(1) && isDotDot && dot) {
+			c->dirDotDot[dir] = number;
+			c->dirDotDotPos[dir] = pos + off;
+			continue;
+		}
+
+		if(!nameLen || DIRENTRY_SIZE(nameLen) > recLen || isDot || isDotDot || memchr(name, '/', nameLen) ||
+			number > MAX_INODES || c->owner[number] != number) {
+			TRACE_WARN("fsck: diretório %u com entrada inválida para o inode %u", dir, number);
+			w->st.badEntries++;
+			ul2char(0, &sector[off+DIRENTRY_INODE]);
+			c->dirDirty[k] = 1;
+			continue;
+		}
+		unsigned int type = _checkInode(c->inodes, number)[RAWINODE_TYPE];
+		if(sector[off+DIRENTRY_TYPE] != type) {
+			w->st.badEntries++;
+			sector[off+DIRENTRY_TYPE] = type;
+			c->dirDirty[k] = 1;
+		}
+		if(_checkAddEntry(w, dir, number, pos + off) == -1) return -1;
+	}
+	return 0;
+}
+
+//função executada por cada thread para conferir as entradas dos
+//diretórios que lhe cabem
+void* _checkDirsWorker(void* arg)
+{
+	CheckWorker* w = arg;
+	Check* c = w->c;
+	for(unsigned int n = 1 + w->id; n <= MAX_INODES && w->ret == 0; n += c->numThreads) {
+		if(c->owner[n] != n || _checkInode(c->inodes, n)[RAWINODE_TYPE] != FILETYPE_DIR) continue;
+		for(unsigned int b = 0; b < c->dirCount[n] && w->ret == 0; b++) {
+			unsigned int k = c->dirFirst[n] + b;
+			for(unsigned int s = 0; s < _sectorsPerBlock() && w->ret == 0; s++) {
+				unsigned int pos = k * superblock.blockSize + s * DISK_SECTORDATASIZE;
+				w->ret = _checkDirSector(w, n, k, pos, b == 0 && s == 0);
+			}
+		}
+		if(!c->dirDotDot[n]) {
+			TRACE_WARN("fsck: diretório %u sem \".\" e \"..\"", n);
+			w->st.unrepairable++;
+		}
+	}
+	return NULL;
+}
+
+//função que confere o mapa de blocos do inode number de uma cópia da área
+//de inodes, contando as referências a cada bloco. entradas inválidas ou
+//além do tamanho do arquivo (exceto blocos reservados) são zeradas se fix
+//for diferente de 0 e ignoradas (inconsistências sem correção) caso
+//contrário. nos snapshots, que não referenciam o que fica além do
+//tamanho, essas entradas não são contadas
+void _checkInodeBlocks(CheckWorker* w, unsigned int* table, unsigned int number, int fix)
+{
+	unsigned int* inode = _checkInode(table, number);
+	unsigned int numBlocks = ((unsigned long long) inode[RAWINODE_SIZE] + superblock.blockSize - 1) / superblock.blockSize;
+	int metadata = inode[RAWINODE_TYPE] == FILETYPE_DIR;
+	unsigned int current = number, count = inodeNumDirectBlocks(), b = 0;
+
+	for(unsigned int steps = 0; ; steps++) {
+		for(unsigned int i = 0; i < count; i++, b++) {
+			if(!inode[i] || (b >= numBlocks && !fix)) continue;
+			int index = b < numBlocks || (inode[i] & BLOCKADDR_UNWRITTEN) ? _checkBlockIndex(inode[i], metadata) : -1;
+			if(index == -1) {
+				TRACE_WARN("fsck: inode %u com endereço %08x inválido no bloco %u", number, inode[i], b);
+				if(fix) {
+					w->st.badBlockAddrs++;
+					inode[i] = 0;
+					w->c->inodeDirty[current] = 1;
+				} else w->st.unrepairable++;
+				continue;
+			}
+			if(w->refs[index] < USHRT_MAX) w->refs[index]++;
+		}
+		current = inode[RAWINODE_NEXT];
+		if(!current || current > MAX_INODES || steps >= MAX_INODES) break;
+		inode = _checkInode(table, current);
+		count = inodeNumBlocksPerExtension();
+	}
+}
+
+//função executada por cada thread para contar as referências aos blocos
+//feitas pelos inodes que lhe cabem, no sistema ativo e nos snapshots
+void* _checkInodesWorker(void* arg)
+{
+	CheckWorker* w = arg;
+	Check* c = w->c;
+	for(unsigned int n = 1 + w->id; n <= MAX_INODES; n += c->numThreads) {
+		if(c->owner[n] == n) _checkInodeBlocks(w, c->inodes, n, 1);
+		for(unsigned int id = 0; id < MAX_SNAPSHOTS; id++) {
+			if(c->snapInodes[id] && _checkIsHead(c->snapInodes[id], n)) _checkInodeBlocks(w, c->snapInodes[id], n, 0);
+		}
+	}
+	return NULL;
+}
+
+//função executada por cada thread para conferir o bitmap, a tabela de
+//referências e a de impressões digitais nos trechos de BITS_PER_SECTOR
+//blocos que lhe cabem (trechos que não dividem setores das tabelas). com
+//a correção, as tabelas em memória passam a refletir as referências
+//encontradas
+void* _checkBlocksWorker(void* arg)
+{
+	CheckWorker* w = arg;
+	Check* c = w->c;
+	CheckWorker* all = c->workers;
+
+	for(unsigned int first = w->id * BITS_PER_SECTOR; first < superblock.sizeBitMap; first += c->numThreads * BITS_PER_SECTOR) {
+		unsigned int last = first + BITS_PER_SECTOR < superblock.sizeBitMap ? first + BITS_PER_SECTOR : superblock.sizeBitMap;
+		for(unsigned int i = first; i < last; i++) {
+			unsigned int total = 0, fp;
+			for(unsigned int t = 0; t < c->numThreads; t++) total += all[t].refs[i];
+			if(total) w->st.blocksUsed++;
+			if(total > REFCOUNT_MAX + 1) {
+				w->st.unrepairable++;
+				total = REFCOUNT_MAX + 1;
+			}
+
+			unsigned char mask = 1 << (i % 8);
+			unsigned char* bits = &superblock.bitMap.data[i/8];
+			unsigned char* refs = &superblock.refCount.data[i];
+			unsigned char* fpBytes = &superblock.fingerprints.data[i * FINGERPRINT_SIZE];
+			unsigned int expected = total ? total - 1 : 0;
+			char2ul(fpBytes, &fp);
+			if(((*bits & mask) != 0) == (total != 0) && *refs == expected && (total || !fp)) continue;
+
+			TRACE_WARN("fsck: bloco %u com %u referências (bitmap %d, contador %u)", i, total, (*bits & mask) != 0, *refs);
+			w->st.badBlocks++;
+			if(!c->repair) continue;
+			if(total) *bits |= mask;
+			else *bits &= ~mask;
+			*refs = expected;
+			if(!total) ul2char(0, fpBytes);
+			superblock.bitMap.flags[i / BITS_PER_SECTOR] |= TABLE_DIRTY;
+			superblock.refCount.flags[i / DISK_SECTORDATASIZE] |= TABLE_DIRTY;
+			superblock.fingerprints.flags[i * FINGERPRINT_SIZE / DISK_SECTORDATASIZE] |= TABLE_DIRTY;
+		}
+	}
+	return NULL;
+}
+
+//função que executa fn em uma thread para cada worker e espera todas
+//terminarem. sem threads disponíveis, o worker é executado na própria
+//thread. retorna 0 ou -1 se algum worker falhou
+int _checkRun(CheckWorker* workers, unsigned int numThreads, void* (*fn)(void*))
+{
+	pthread_t threads[CHECK_MAX_THREADS];
+	int started[CHECK_MAX_THREADS];
+	int ret = 0;
+
+	for(unsigned int t = 0; t < numThreads; t++) {
+		started[t] = pthread_create(&threads[t], NULL, fn, &workers[t]) == 0;
+		if(!started[t]) fn(&workers[t]);
+	}
+	for(unsigned int t = 0; t < numThreads; t++) {
+		if(started[t]) pthread_join(threads[t], NULL);
+		if(workers[t].ret == -1) ret = -1;
+	}
+	return ret;
+}
+
+//função que confere as ligações entre diretórios e inodes a partir das
+//entradas encontradas: cada diretório tem uma única entrada e o ".."
+//correto, o contador de referências de um arquivo é a sua quantidade de
+//entradas e inodes inalcançáveis a partir da raiz são liberados
+//(liberando também o que só eles alcançavam). retorna 0 ou -1
+int _checkLinks(Check* c, CheckWorker* workers, MyFSCheckStat* st)
+{
+	unsigned int* links = calloc(MAX_INODES + 1, sizeof(unsigned int));
+	unsigned int* parent = calloc(MAX_INODES + 1, sizeof(unsigned int));
+	unsigned int* stack = malloc((MAX_INODES + 1) * sizeof(unsigned int));
+	unsigned char* queued = calloc(MAX_INODES + 1, 1);
+	int ret = links && parent && stack && queued ? 0 : -1;
+
+	//um diretório só pode ter uma entrada: as demais são descartadas
+	for(unsigned int t = 0; t < c->numThreads && ret == 0; t++) {
+		for(unsigned int e = 0; e < workers[t].numEntries; e++) {
+			CheckEntry* entry = &workers[t].entries[e];
+			if(_checkInode(c->inodes, entry->target)[RAWINODE_TYPE] == FILETYPE_DIR) {
+				if(parent[entry->target] || entry->target == ID_INODE_DEFAULT) {
+					TRACE_WARN("fsck: diretório %u com mais de uma entrada", entry->target);
+					st->badEntries++;
+					ul2char(0, &c->dirData[entry->pos + DIRENTRY_INODE]);
+					c->dirDirty[entry->pos / superblock.blockSize] = 1;
+					entry->target = 0;
+					continue;
+				}
+				parent[entry->target] = entry->dir;
+			}
+			links[entry->target]++;
+		}
+	}
+
+	//inodes sem entradas e diretórios que não chegam à raiz
+	unsigned int top = 0;
+	for(unsigned int n = 1; n <= MAX_INODES && ret == 0; n++) {
+		if(c->owner[n] != n || n == ID_INODE_DEFAULT) continue;
+		unsigned int p = n;
+		for(unsigned int steps = 0; p && p != ID_INODE_DEFAULT && steps < MAX_INODES; steps++) p = parent[p];
+		if(!links[n] || (_checkInode(c->inodes, n)[RAWINODE_TYPE] == FILETYPE_DIR && p != ID_INODE_DEFAULT)) {
+			stack[top++] = n;
+			queued[n] = 1;
+		}
+	}
+	while(top) {
+		unsigned int n = stack[--top];
+		TRACE_WARN("fsck: inode %u inalcançável", n);
+		st->orphans++;
+		if(_checkInode(c->inodes, n)[RAWINODE_TYPE] == FILETYPE_DIR) {
+			for(unsigned int t = 0; t < c->numThreads; t++) {
+				for(unsigned int e = 0; e < workers[t].numEntries; e++) {
+					CheckEntry* entry = &workers[t].entries[e];
+					if(entry->dir != n || !entry->target) continue;
+					if(!--links[entry->target] && !queued[entry->target]) {
+						stack[top++] = entry->target;
+						queued[entry->target] = 1;
+					}
+					entry->target = 0;
+				}
+			}
+		}
+		_checkRelease(c, n);
+	}
+
+	for(unsigned int n = 1; n <= MAX_INODES && ret == 0; n++) {
+		if(c->owner[n] != n) continue;
+		unsigned int* inode = _checkInode(c->inodes, n);
+		unsigned int expected = inode[RAWINODE_TYPE] == FILETYPE_DIR ? 1 : links[n];
+		if(inode[RAWINODE_REFCOUNT] != expected) {
+			TRACE_WARN("fsck: inode %u com %u referências, esperadas %u", n, inode[RAWINODE_REFCOUNT], expected);
+			st->badLinks++;
+			inode[RAWINODE_REFCOUNT] = expected;
+			c->inodeDirty[n] = 1;
+		}
+
+		unsigned int up = n == ID_INODE_DEFAULT ? ID_INODE_DEFAULT : parent[n];
+		if(inode[RAWINODE_TYPE] == FILETYPE_DIR && c->dirDotDot[n] && c->dirDotDot[n] != up) {
+			TRACE_WARN("fsck: diretório %u com \"..\" para %u, esperado %u", n, c->dirDotDot[n], up);
+			st->badEntries++;
+			ul2char(up, &c->dirData[c->dirDotDotPos[n] + DIRENTRY_INODE]);
+			c->dirDirty[c->dirDotDotPos[n] / superblock.blockSize] = 1;
+		}
+	}
+
+	free(links);
+	free(parent);
+	free(stack);
+	free(queued);
+	return ret;
+}
+
+//função que grava as correções em transações limitadas ao tamanho do
+//journal: os blocos de diretório alterados, de JOURNAL_DIR_BLOCKS em
+//JOURNAL_DIR_BLOCKS, e por fim os setores de inodes, as tabelas e o setor
+//do superbloco. as entradas são corrigidas antes de os inodes serem
+//liberados: uma falha no meio deixa no máximo inodes inalcançáveis, que a
+//próxima verificação libera. retorna 0 ou -1
+int _checkWrite(Disk* d, Check* c)
+{
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int perSector = inodeNumInodesPerSector();
+	int ret = 0;
+
+	for(unsigned int k = 0; k < c->numDirBlocks && ret == 0; ) {
+		journalBegin();
+		for(unsigned int n = 0; k < c->numDirBlocks && n < JOURNAL_DIR_BLOCKS && ret == 0; k++) {
+			if(!c->dirDirty[k]) continue;
+			for(unsigned int s = 0; s < _sectorsPerBlock() && ret == 0; s++) {
+				ret = journalWriteSector(d, c->dirAddrs[k] + s, &c->dirData[(size_t) k * superblock.blockSize + s * DISK_SECTORDATASIZE]);
+			}
+			n++;
+		}
+		journalEnd();
+	}
+
+	journalBegin();
+	for(unsigned int k = 0; k < _inodeTableSectors() && ret == 0; k++) {
+		int dirty = 0;
+		for(unsigned int i = 0; i < perSector; i++) dirty |= c->inodeDirty[k * perSector + i + 1];
+		if(!dirty) continue;
+		for(unsigned int w = 0; w < DISK_SECTORDATASIZE / sizeof(unsigned int); w++) {
+			ul2char(c->inodes[k * DISK_SECTORDATASIZE / sizeof(unsigned int) + w], &sector[4*w]);
+		}
+		ret = _inodeWriteSector(d, inodeAreaBeginSector() + k, sector);
+	}
+	_superBlockDirty();
+	if(ret == 0) ret = _superBlockFlush(d);
+	journalEnd();
+	if(ret == 0) ret = journalSync();
+	return ret;
+}
+
+//função que libera a memória da verificação de consistência
+void _checkFree(Check* c, CheckWorker* workers)
+{
+	free(c->inodes);
+	for(unsigned int id = 0; id < MAX_SNAPSHOTS; id++) free(c->snapInodes[id]);
+	free(c->inodeDirty);
+	free(c->owner);
+	free(c->dirFirst);
+	free(c->dirCount);
+	free(c->dirDotDot);
+	free(c->dirDotDotPos);
+	free(c->dirAddrs);
+	free(c->dirDirty);
+	free(c->dirData);
+	for(unsigned int t = 0; t < c->numThreads; t++) {
+		free(workers[t].refs);
+		free(workers[t].entries);
+	}
+}
+
+//função que reserva os buffers de compressão, do tamanho de um bloco
+int _zInit(void)
+{
+	if(superblock.zBlock == NULL) superblock.zBlock = malloc(superblock.blockSize);
+	if(superblock.zData == NULL) superblock.zData = malloc(superblock.blockSize);
+	return superblock.zBlock != NULL && superblock.zData != NULL ? 0 : -1;
+}
+
+//função que retorna o bloco comprimido da entrada entry do mapa de um
+//arquivo já descomprimido. apenas os setores ocupados pelos dados
+//comprimidos são lidos, e o último bloco usado fica guardado para leituras
+//seguidas. retorna NULL em caso de erro
+unsigned char* _zBlockLoad(Disk* d, unsigned int entry)
+{
+	if(_zInit() == -1) return NULL;
+	if(superblock.zEntry == entry) return superblock.zBlock;
+
+	unsigned int numSectors = BLOCKADDR_ZSECTORS(entry);
+	superblock.zEntry = 0;
+	for(unsigned int s = 0; s < numSectors; s++) {
+		if(diskReadSector(d, BLOCKADDR(entry) + s, &superblock.zData[s * DISK_SECTORDATASIZE]) == -1) return NULL;
+	}
+	if(lzDecompress(superblock.zData, numSectors * DISK_SECTORDATASIZE, superblock.zBlock, superblock.blockSize) == -1) {
+		TRACE_ERROR("bloco comprimido %u corrompido", BLOCKADDR(entry));
+		return NULL;
+	}
+	superblock.zEntry = entry;
+	return superblock.zBlock;
+}
+
+//função que escreve n bytes de buf a partir de off no bloco blockNum de um
+//inode, de entrada entry no mapa, regravando o bloco inteiro: comprimido
+//se a compressão estiver ativa e os dados economizarem ao menos um setor,
+//sem compressão caso contrário. um bloco compartilhado ou sem endereço é
+//gravado em um bloco novo. retorna 0 ou -1
+int _zBlockWrite(Disk* d, Inode* inode, unsigned int blockNum, unsigned int entry,
+	unsigned int off, const unsigned char* buf, unsigned int n)
+{
+	unsigned int addr = BLOCKADDR(entry);
+	unsigned int spb = _sectorsPerBlock();
+	if(_zInit() == -1) return -1;
+
+	//monta o conteúdo novo do bloco em zBlock
+	if(entry == 0) {
+		if(_bufIsZero((const char*) buf, n)) return 0; //o buraco continua
+		superblock.zEntry = 0;
+		memset(superblock.zBlock, 0, superblock.blockSize);
+	} else if(BLOCKADDR_ZSECTORS(entry)) {
+		if(_zBlockLoad(d, entry) == NULL) return -1;
+		superblock.zEntry = 0;
+	} else {
+		superblock.zEntry = 0;
+		if(_dataRead(d, addr, 0, superblock.zBlock, superblock.blockSize) == -1) return -1;
+	}
+	memcpy(&superblock.zBlock[off], buf, n);
+
+	int len = -1;
+	if((superblock.flags & MYFS_FLAG_COMPRESS) && spb <= BLOCKADDR_ZSECTORS_MAX) {
+		len = lzCompress(superblock.zBlock, superblock.blockSize, superblock.zData, superblock.blockSize - DISK_SECTORDATASIZE);
+	}
+	unsigned int numSectors = spb;
+	const unsigned char* data = superblock.zBlock;
+	if(len != -1) {
+		numSectors = (len + DISK_SECTORDATASIZE - 1) / DISK_SECTORDATASIZE;
+		memset(&superblock.zData[len], 0, numSectors * DISK_SECTORDATASIZE - len);
+		data = superblock.zData;
+	}
+
+	//blocos compartilhados com snapshots ou clones não são alterados
+	int refs = addr ? _blockRefs(addr) : 0;
+	if(refs == -1) return -1;
+	int fresh = addr == 0 || refs > 0;
+	int target = fresh ? _blockAlloc(d, inodeGetNumber(inode)) : (int) addr;
+	if(target == -1) return -1;
+
+	_bcacheInvalidate(target);
+	for(unsigned int s = 0; s < numSectors; s++) {
+		if(fresh) journalForget(target + s);
+		if(diskWriteSector(d, target + s, (unsigned char*) &data[s * DISK_SECTORDATASIZE]) == -1) {
+			if(fresh) _bitMapSetBusyPerFree(target);
+			return -1;
+		}
+	}
+
+	unsigned int newEntry = target | (len != -1 ? numSectors << BLOCKADDR_BITS : 0);
+	if(newEntry != entry && _inodeSetBlock(inode, blockNum, newEntry) == -1) {
+		if(fresh) _bitMapSetBusyPerFree(target);
+		return -1;
+	}
+	if(refs > 0) _blockPut(addr);
+
+	if(len != -1) superblock.zEntry = newEntry;
+	if(superblock.flags & MYFS_FLAG_COMPRESS) {
+		superblock.zIn += superblock.blockSize;
+		superblock.zOut += numSectors * DISK_SECTORDATASIZE;
+	}
+	return 0;
+}
+
+//função que escreve n bytes de buf na posição blockOff do bloco blockNum
+//de um arquivo, de entrada addr no mapa, conforme o estado do bloco:
+//reservado, deduplicado, comprimido, compartilhado, próprio ou buraco.
+//retorna 0 ou -1
+int _fileWriteBlock(Disk* d, Inode* inode, unsigned int blockNum, unsigned int addr,
+	unsigned int blockOff, const unsigned char* buf, unsigned int n)
+{
+	if(addr & BLOCKADDR_UNWRITTEN) {
+		if(_unwrittenWrite(d, inode, blockNum, addr, blockOff, buf, n) == -1) return -1;
+	} else if((superblock.flags & MYFS_FLAG_DEDUP) && n == superblock.blockSize &&
+		!(superblock.flags & MYFS_FLAG_COMPRESS) && !BLOCKADDR_ZSECTORS(addr)) {
+		if(_dedupWrite(d, inode, blockNum, addr, buf) == -1) return -1;
+	} else if((superblock.flags & MYFS_FLAG_COMPRESS) || BLOCKADDR_ZSECTORS(addr)) {
+		pthread_mutex_lock(&zLock);
+		int ret = _zBlockWrite(d, inode, blockNum, addr, blockOff, buf, n);
+		pthread_mutex_unlock(&zLock);
+		if(ret == -1) return -1;
+	} else if(addr != 0) {
+		//bloco compartilhado com um snapshot ou clone: a escrita vai
+		//para uma cópia
+		int refs = _blockRefs(addr);
+		if(refs > 0) {
+			int copy = _blockCow(d, inode, blockNum, addr, 0);
+			if(copy == -1) return -1;
+			addr = copy;
+		}
+		if(refs == -1 || _dataWrite(d, addr, blockOff, buf, n, 0) == -1) return -1;
+	} else if(!_bufIsZero((const char*) buf, n)) {
+		//zeros escritos em um buraco não ocupam espaço; qualquer outro
+		//dado ocupa um bloco novo, cujo restante é zerado
+		int block = _blockAlloc(d, inodeGetNumber(inode));
+		if(block == -1) return -1;
+		if(_dataWrite(d, block, blockOff, buf, n, 1) == -1 ||
+			_inodeSetBlock(inode, blockNum, block) == -1) {
+			_bitMapSetBusyPerFree(block);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+//função que procura, a partir da posição pos, o primeiro byte de dados
+//(data diferente de 0) ou de um buraco de um arquivo. o fim do arquivo e
+//os blocos reservados ainda não escritos contam como buraco. retorna a
+//posição ou -1 se não houver dados
+long _fileSeekData(Inode* inode, unsigned int pos, int data)
+{
+	unsigned int size = inodeGetFileSize(inode);
+	for(unsigned int b = pos / superblock.blockSize; (long) b * superblock.blockSize < size; b++) {
+		unsigned int entry = inodeGetBlockAddr(inode, b);
+		if((entry != 0 && !(entry & BLOCKADDR_UNWRITTEN)) == (data != 0)) {
+			unsigned int start = b * superblock.blockSize;
+			return start > pos ? start : pos;
+		}
+	}
+	return data ? -1 : (long) size;
+}
+
+//função que abre (criando caso não exista) o arquivo ou diretório
+//do caminho dado e ocupa um descritor para ele. deve ser chamada com
+//nsLock; allocLock só é obtido para criar o arquivo, não durante o
+//percurso do caminho. retorna o descritor ou -1 em caso de erro
+int _openPath(Disk* d, const char* path, unsigned int fileType)
+{
+	if(d == NULL || path == NULL) return -1;
+
+	unsigned int parent;
+	char name[MAX_FILE_LENGTH+1];
+	if(_pathWalk(d, path, &parent, name) == -1) return -1;
+
+	unsigned int number = name[0] ? _dirLookup(d, parent, name) : ID_INODE_DEFAULT;
+	TRACE_DEBUG("open '%s': pai %u, inode %u", path, parent, number);
+	TRACE_EVENT(TRACE_OP_OPEN, number, parent);
+
+	//arquivo ja aberto: o novo descritor compartilha o mesmo inode
+	OpenFile* file = number ? _openFileFind(number, 0) : NULL;
+	if(file != NULL) {
+		if(file->type != fileType) return -1;
+		file->refCount++;
+	} else {
+		Inode* inode = NULL;
+		if(number) {
+			inode = inodeLoad(number, d);
+			if(inode == NULL) return -1;
+			if(inodeGetFileType(inode) != fileType) {
+				free(inode);
+				return -1;
+			}
+		} else {
+			//caso não tenha esse arquivo, então cria
+			pthread_mutex_lock(&allocLock);
+			journalBegin();
+			inode = _createEntry(d, parent, name, fileType);
+			_superBlockFlush(d);
+			journalEnd();
+			pthread_mutex_unlock(&allocLock);
+			if(inode == NULL) return -1;
+		}
+
+		file = _openFileInsert(inode);
+		if(file == NULL) {
+			free(inode);
+			return -1;
+		}
+	}
+
+	int fd = _fdAlloc(file);
+	if(fd == -1) _openFilePut(file);
+	return fd;
+}
+
+//função que retorna a entrada da tabela de descritores correspondente a
+//fd, aberta ou não, sem nenhum lock. retorna NULL se fd for inválido
+FileDescriptor* _fdEntry(int fd)
+{
+	if(fd <= 0 || (unsigned int) fd > __atomic_load_n(&fdTable.size, __ATOMIC_ACQUIRE)) return NULL;
+	return &fdTable.pages[(fd-1) / FD_PAGE_SIZE][(fd-1) % FD_PAGE_SIZE];
+}
+
+//função que retorna a entrada aberta da tabela de descritores
+//correspondente a fd, se for do tipo dado. deve ser chamada com nsLock,
+//que impede o fechamento. caso contrário retorna NULL
+FileDescriptor* _fdGet(int fd, unsigned int fileType)
+{
+	FileDescriptor* f = _fdEntry(fd);
+	if(f == NULL || f->file == NULL || f->file->type != fileType) return NULL;
+	return f;
+}
+
+//função que trava o descritor aberto fd, se for do tipo dado, até
+//_fdUnlock: enquanto isso ele não é fechado. o cursor só pode ser usado
+//com exclusive; sem ele, várias threads usam o descritor ao mesmo tempo.
+//retorna NULL caso contrário
+FileDescriptor* _fdLock(int fd, unsigned int fileType, int exclusive)
+{
+	FileDescriptor* f = _fdEntry(fd);
+	if(f == NULL) return NULL;
+	if(exclusive) pthread_rwlock_wrlock(&f->lock);
+	else pthread_rwlock_rdlock(&f->lock);
+	if(f->file == NULL || f->file->type != fileType) {
+		pthread_rwlock_unlock(&f->lock);
+		return NULL;
+	}
+	return f;
+}
+
+//função que destrava um descritor travado por _fdLock
+void _fdUnlock(FileDescriptor* f)
+{
+	pthread_rwlock_unlock(&f->lock);
+}
+
+//função que libera um descritor, devolvendo-o à lista de livres. deve
+//ser chamada com nsLock; espera as operações em andamento no descritor
+int _fdRelease(int fd, unsigned int fileType)
+{
+	FileDescriptor* f = _fdLock(fd, fileType, 1);
+	if(f == NULL) return -1;
+
+	//arquivo removido enquanto aberto: é liberado com o último descritor
+	int ret = 0;
+	OpenFile* file = f->file;
+	pthread_mutex_lock(&allocLock);
+	if(file->refCount == 1 && !file->view && inodeGetRefCount(file->inode) == 0) {
+		journalBegin();
+		ret = _fileFree(superblock.disk, file->number, 0, 1);
+		if(_superBlockFlush(superblock.disk) == -1) ret = -1;
+		journalEnd();
+	}
+
+	_openFilePut(f->file);
+	__atomic_store_n(&f->file, NULL, __ATOMIC_RELEASE);
+	f->cursor = 0;
+	f->nextFree = fdTable.freeList;
+	fdTable.freeList = fd-1;
+	_fdUnlock(f);
+
+	//sem arquivos abertos, as alterações agrupadas são confirmadas
+	if(!__atomic_sub_fetch(&fdTable.openCount, 1, __ATOMIC_RELEASE) && journalSync() == -1) ret = -1;
+	pthread_mutex_unlock(&allocLock);
+	return ret;
+}
+
+//função que relê o inode do diretório aberto file se a posição pos estiver
+//além do seu fim: o diretório pode ter crescido desde a abertura. deve ser
+//chamada com nsLock. retorna 0 ou -1
+int _dirRefresh(OpenFile* file, unsigned int pos)
+{
+	if(pos < inodeGetFileSize(file->inode)) return 0;
+	Inode* dir = inodeLoad(file->number, superblock.disk);
+	if(dir == NULL) return -1;
+	free(file->inode);
+	file->inode = dir;
+	return 0;
+}
+
+//função que lê a entrada do diretório na posição do cursor do descritor
+//f, avançando-o. retorna 1 se leu uma entrada, 0 no fim ou -1
+int _dirReadEntry(FileDescriptor* f, char* filename, unsigned int* inumber)
+{
+
+	Disk* d = superblock.disk;
+	unsigned char sector[DISK_SECTORDATASIZE];
+
+	if(_dirRefresh(f->file, f->cursor) == -1) return -1;
+
+	while(f->cursor < inodeGetFileSize(f->file->inode)) {
+		unsigned int s = f->cursor / DISK_SECTORDATASIZE;
+		if(journalReadSector(d, _dirSectorAddr(f->file->inode, s), sector) == -1) return -1;
+
+		for(unsigned int off = f->cursor % DISK_SECTORDATASIZE; off < DISK_SECTORDATASIZE; off = _dirEntryNext(sector, off)) {
+			unsigned int number;
+			char2ul(&sector[off+DIRENTRY_INODE], &number);
+			if(number) {
+				unsigned int nameLen = sector[off+DIRENTRY_NAMELEN];
+				memcpy(filename, &sector[off+DIRENTRY_HEADER], nameLen);
+				filename[nameLen] = '\0';
+				*inumber = number;
+				f->cursor = s*DISK_SECTORDATASIZE + _dirEntryNext(sector, off);
+				return 1;
+			}
+		}
+		f->cursor = (s+1)*DISK_SECTORDATASIZE;
+	}
+
+	return 0;
+}
+
+//função que copia para buf, a partir da posição *pos do diretório aberto
+//file, tantas entradas em uso quantas couberem em nbytes bytes, como
+//registros VfsDirent, até maxEntries entradas (0 sem limite), percorrendo
+//os setores do diretório em ordem e lendo cada um uma única vez. *pos
+//passa a ser a posição da primeira entrada não copiada. deve ser chamada
+//com nsLock. retorna os bytes copiados, 0 no fim do diretório ou -1
+//(inclusive se a primeira entrada não couber)
+int _dirGetdents(OpenFile* file, unsigned int* pos, char* buf, unsigned int nbytes, unsigned int maxEntries)
+{
+	Disk* d = superblock.disk;
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int done = 0, count = 0;
+
+	if(_dirRefresh(file, *pos) == -1) return -1;
+	while(*pos < inodeGetFileSize(file->inode)) {
+		unsigned int s = *pos / DISK_SECTORDATASIZE;
+		if(journalReadSector(d, _dirSectorAddr(file->inode, s), sector) == -1) return done ? (int) done : -1;
+
+		for(unsigned int off = *pos % DISK_SECTORDATASIZE; off < DISK_SECTORDATASIZE; off = _dirEntryNext(sector, off)) {
+			unsigned int number;
+			char2ul(&sector[off+DIRENTRY_INODE], &number);
+			if(number) {
+				unsigned int nameLen = sector[off+DIRENTRY_NAMELEN];
+				unsigned int recLen = VFS_DIRENT_SIZE(nameLen);
+				if(recLen > nbytes - done || (maxEntries && count == maxEntries)) return done ? (int) done : -1;
+
+				VfsDirent* ent = (VfsDirent*) &buf[done];
+				ent->inumber = number;
+				ent->recLen = recLen;
+				ent->nameLen = nameLen;
+				ent->type = sector[off+DIRENTRY_TYPE];
+				memcpy(ent->name, &sector[off+DIRENTRY_HEADER], nameLen);
+				ent->name[nameLen] = '\0';
+				done += recLen;
+				count++;
+			}
+			*pos = s*DISK_SECTORDATASIZE + _dirEntryNext(sector, off);
+		}
+		*pos = (s+1)*DISK_SECTORDATASIZE;
+	}
+	return done;
+}
+
+//função de comparação do qsort para ordenar pares (inode, posição) pelo
+//numero do inode
+int _inodePairCompare(const void* a, const void* b)
+{
+	unsigned int x = ((const unsigned int*) a)[0], y = ((const unsigned int*) b)[0];
+	return x < y ? -1 : x > y;
+}
+
+//função que copia para out até max entradas do diretório aberto file a
+//partir da posição *pos, com os atributos dos seus inodes. as entradas
+//são lidas como em _dirGetdents; depois os numeros dos inodes são
+//ordenados e cada setor da área de inodes necessário é lido uma única
+//vez, em ordem crescente. em caso de erro *pos não muda. deve ser
+//chamada com nsLock. retorna a quantidade de entradas, 0 no fim do
+//diretório ou -1
+int _dirReaddirPlus(OpenFile* file, unsigned int* pos, VfsDirentPlus* out, unsigned int max)
+{
+	if(max == 0) return -1;
+	unsigned int nbytes = max * VFS_DIRENT_SIZE(MAX_FILENAME_LENGTH);
+	char* buf = malloc(nbytes);
+	unsigned int* pairs = malloc(2 * max * sizeof(unsigned int));
+	if(buf == NULL || pairs == NULL) {
+		free(buf);
+		free(pairs);
+		return -1;
+	}
+
+	unsigned int start = *pos;
+	unsigned int count = 0;
+	int ret = _dirGetdents(file, pos, buf, nbytes, max);
+
+	for(int off = 0; off < ret; count++) {
+		VfsDirent* ent = (VfsDirent*) &buf[off];
+		out[count].inumber = ent->inumber;
+		out[count].type = ent->type;
+		memcpy(out[count].name, ent->name, ent->nameLen + 1);
+		pairs[2*count] = ent->inumber;
+		pairs[2*count+1] = count;
+		off += ent->recLen;
+	}
+	free(buf);
+	if(ret > 0) ret = count;
+
+	//um ls -l percorre a área de inodes uma vez, em vez de um setor
+	//aleatório por entrada
+	qsort(pairs, count, 2 * sizeof(unsigned int), _inodePairCompare);
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int loaded = UINT_MAX;
+	for(unsigned int i = 0; i < count && ret != -1; i++) {
+		unsigned int number = pairs[2*i];
+		unsigned int k = (number - 1) / inodeNumInodesPerSector();
+		if(k != loaded && _inodeReadSector(superblock.disk, inodeAreaBeginSector() + k, sector) == -1) {
+			ret = -1;
+			break;
+		}
+		loaded = k;
+
+		unsigned char* inode = &sector[(number - 1) % inodeNumInodesPerSector() * RAWINODE_WORDS * sizeof(unsigned int)];
+		VfsDirentPlus* e = &out[pairs[2*i+1]];
+		e->type = _batchWord(inode, RAWINODE_TYPE);
+		e->size = _batchWord(inode, RAWINODE_SIZE);
+		e->owner = _batchWord(inode, RAWINODE_OWNER);
+		e->permission = _batchWord(inode, RAWINODE_PERMISSION);
+	}
+	free(pairs);
+
+	//um novo pedido relê o mesmo lote
+	if(ret == -1) *pos = start;
+	return ret;
+}
+
+//função que grava o estado pendente do disco d e o marca como desmontado
+//corretamente. deve ser chamada com fsLock exclusivo. retorna 0 ou -1
+int _unmount(Disk* d)
+{
+	//um disco que não é o ativo já foi desmontado ao trocar de disco
+	if(superblock.disk != d) return 0;
+	if(fdTable.openCount) return -1;
+
+	//o estado limpo só chega à posição definitiva junto com o checkpoint
+	//final, depois de todas as transações pendentes
+	superblock.state = MYFS_STATE_CLEAN;
+	_superBlockDirty();
+	journalBegin();
+	int ret = _superBlockFlush(d);
+	journalEnd();
+	if(ret == 0 && journalClose() == -1) ret = -1;
+	TRACE_EVENT(TRACE_OP_UNMOUNT, 0, ret);
+
+	_releaseDirRoot();
+	return ret;
+}
+
+//função que monta o sistema de arquivos do disco d, desmontando o disco
+//montado antes. o estado em memória é único: enquanto um disco estiver
+//montado por myFSMount, nenhum outro é montado. deve ser chamada com
+//fsLock exclusivo. retorna 0 ou -1
+int _mount(Disk* d)
+{
+	if(d == NULL) return -1;
+	if(superblock.pinned != NULL && superblock.pinned != d) {
+		TRACE_ERROR("outro disco já está montado");
+		return -1;
+	}
+	if(superblock.disk == d) return 0;
+	if(superblock.disk != NULL && _unmount(superblock.disk) == -1) return -1;
+
+	if(_initDirRoot(d) == -1) {
+		_releaseDirRoot();
+		return -1;
+	}
+	return 0;
+}
+
+//função que inicia uma operação pública sobre o disco d, montando-o se
+//preciso, com fsLock compartilhado ou, se exclusive, exclusivo. com d NULL
+//apenas obtém o lock. retorna 0 ou -1 (sem o lock)
+int _fsEnter(Disk* d, int exclusive)
+{
+	if(exclusive) pthread_rwlock_wrlock(&fsLock);
+	else pthread_rwlock_rdlock(&fsLock);
+
+	//a montagem automática precisa do lock exclusivo
+	while(d != NULL && superblock.disk != d) {
+		if(!exclusive) {
+			pthread_rwlock_unlock(&fsLock);
+			pthread_rwlock_wrlock(&fsLock);
+		}
+		int ret = superblock.disk == d ? 0 : _mount(d);
+		pthread_rwlock_unlock(&fsLock);
+		if(ret == -1) return -1;
+		if(exclusive) pthread_rwlock_wrlock(&fsLock);
+		else pthread_rwlock_rdlock(&fsLock);
+	}
+	return 0;
+}
+
+//função que termina uma operação pública iniciada por _fsEnter
+void _fsLeave(void)
+{
+	pthread_rwlock_unlock(&fsLock);
+}
+
+//função que formata o disco d com blocos de blockSize bytes. deve ser
+//chamada com fsLock exclusivo. retorna o total de blocos ou -1
+int _format(Disk* d, unsigned int blockSize)
+{
+	if(superblock.pinned != NULL && superblock.pinned != d) return -1; //o estado em memória é do disco montado
+	if(d != NULL && blockSize >= DISK_SECTORDATASIZE && blockSize % DISK_SECTORDATASIZE == 0) {
+		_releaseDirRoot();
+		
+		//o disco não é zerado: apenas os metadados abaixo são gravados, e
+		//o restante é descartado. nenhum setor fora deles é lido antes de
+		//ser escrito (blocos livres, buracos e blocos reservados não são
+		//lidos, e um bloco novo tem o restante zerado por _dataWrite)
+		if(diskDiscardSectors(d, 0, diskGetNumSectors(d)) == -1) return -1;
+
+		//armazena o valor total de blocos e o blocksize no super bloco
+		superblock.totalBlocks = diskGetSize(d) / blockSize;
+		superblock.blockSize = blockSize;
+
+		//o journal fica logo depois do superbloco (setor 0) e do seu
+		//cabeçalho (setor JOURNAL_HEADER_SECTOR), perto dos demais metadados
+		unsigned int journalSectors = _journalSectors(d);
+		if(SECTOR_JOURNAL + journalSectors >= diskGetNumSectors(d)) return -1;
+		if(journalFormat(d, SECTOR_JOURNAL, journalSectors) == -1) return -1;
+		superblock.sectorInit = SECTOR_JOURNAL + journalSectors;
+
+		//o bitmap (um bit por bloco), a tabela de referências (um byte por
+		//bloco) e a de impressões digitais ficam logo depois do journal,
+		//seguidos pelos blocos de dados. os setores das tabelas são
+		//descontados da área de dados antes de calcular quantos blocos cabem nela
+		unsigned int sectorsLeft = diskGetNumSectors(d) - superblock.sectorInit;
+		unsigned int bitMapNumSectors = (sectorsLeft / _sectorsPerBlock() + BITS_PER_SECTOR - 1) / BITS_PER_SECTOR;
+		unsigned int refCountNumSectors = _refCountNumSectors(sectorsLeft / _sectorsPerBlock());
+		unsigned int fingerprintNumSectors = _fingerprintNumSectors(sectorsLeft / _sectorsPerBlock());
+		unsigned int tablesNumSectors = bitMapNumSectors + refCountNumSectors + fingerprintNumSectors;
+		if(tablesNumSectors >= sectorsLeft) return -1;
+
+		//as tabelas novas não precisam ser lidas e são gravadas inteiras
+		if(_tableInit(&superblock.bitMap, superblock.sectorInit, bitMapNumSectors, 1) == -1) return -1;
+		if(_tableInit(&superblock.refCount, superblock.sectorInit + bitMapNumSectors, refCountNumSectors, 1) == -1) return -1;
+		if(_tableInit(&superblock.fingerprints, superblock.sectorInit + bitMapNumSectors + refCountNumSectors, fingerprintNumSectors, 1) == -1) return -1;
+		superblock.sectorInit += tablesNumSectors;
+
+		//divide o restante em grupos de cilindros de pelo menos
+		//CG_MIN_CYLINDERS cilindros, cada um com a sua fatia dos inodes
+		//(1024/8 = 128 setores no total) seguida dos blocos de dados
+		unsigned int dataSectors = sectorsLeft - tablesNumSectors;
+		unsigned int minGroupSectors = CG_MIN_CYLINDERS * (diskGetNumSectors(d) / diskGetNumCylinders(d));
+		superblock.numGroups = 1;
+		while(superblock.numGroups < CG_MAX_GROUPS && dataSectors / (superblock.numGroups * 2) >= minGroupSectors) {
+			superblock.numGroups *= 2;
+		}
+
+		//extensões de inode guardam um endereço de bloco na posição do tipo
+		//(ver _inodeTableRefBlocks): o primeiro bloco de dados fica depois
+		//de FILETYPE_DIR para que nenhum endereço coincida com um tipo
+		if(superblock.sectorInit + _inodeSliceSectors() <= FILETYPE_DIR) {
+			unsigned int pad = FILETYPE_DIR + 1 - superblock.sectorInit - _inodeSliceSectors();
+			if(pad >= dataSectors) return -1;
+			superblock.sectorInit += pad;
+			dataSectors -= pad;
+		}
+		superblock.groupSectors = dataSectors / superblock.numGroups;
+		if(superblock.groupSectors < _inodeSliceSectors() + _sectorsPerBlock()) return -1;
+		superblock.groupBlocks = (superblock.groupSectors - _inodeSliceSectors()) / _sectorsPerBlock();
+		superblock.sizeBitMap = superblock.numGroups * superblock.groupBlocks;
+		memset(superblock.snapshots, 0, sizeof(superblock.snapshots));
+		superblock.flags = 0;
+		superblock.freeBlocks = superblock.sizeBitMap;
+		superblock.freeInodes = MAX_INODES;
+		_groupsInit();
+		superblock.state = MYFS_STATE_CLEAN;
+		superblock.dirty = 1;
+		superblock.disk = d;
+		inodeSetMaxNumber(MAX_INODES);
+		inodeSetSectorIO(_inodeReadSector, _inodeWriteSector);
+
+		//cria os inodes do primeiro grupo e armazena no disco
+		if(_initInode(d, 0, _inodeSliceSectors()) == -1) return -1;
+		//cria o diretorio raiz e um bloco de dados e armazena no superbloco o bloco do diretorio raiz
+		int blockRoot = _createDirRoot(d);
+		if(blockRoot == -1) return -1;
+		superblock.blockRoot = blockRoot;
+		superblock.freeInodes--;
+		
+		//escreve no setor zero o superbloco e o bitmap
+		if(_superBlockFlush(d) == -1) return -1;
+
+		//os inodes dos demais grupos ficam por último, em uma única
+		//passada até o fim do disco
+		if(_initInode(d, _inodeSliceSectors(), _inodeTableSectors()) == -1) return -1;
+
+		//o sistema de arquivos será lido novamente do disco na próxima abertura
+		_releaseDirRoot();
+		
+		return superblock.totalBlocks > 0 ? superblock.totalBlocks : -1;
+	}
+	return -1;
+}
+
+//função que retorna o total de bytes dos iovcnt buffers de iov, limitado
+//a UINT_MAX, ou -1 se algum buffer for inválido
+long _iovTotal(const VfsIovec* iov, int iovcnt)
+{
+	if(iov == NULL || iovcnt < 1) return -1;
+	unsigned long total = 0;
+	for(int i = 0; i < iovcnt; i++) {
+		if(iov[i].base == NULL && iov[i].len) return -1;
+		total += iov[i].len;
+	}
+	return total > UINT_MAX ? UINT_MAX : (long) total;
+}
+
+//função que retorna o endereço da posição pos da sequência de buffers iov
+//se os n bytes a partir dela estiverem em um único buffer, ou NULL
+unsigned char* _iovSpan(const VfsIovec* iov, int iovcnt, unsigned int pos, unsigned int n)
+{
+	for(int i = 0; i < iovcnt; pos -= iov[i].len, i++)
+		if(pos < iov[i].len) return pos + n <= iov[i].len ? (unsigned char*) iov[i].base + pos : NULL;
+	return NULL;
+}
+
+//função que copia n bytes entre buf e a posição pos da sequência de
+//buffers iov: para os buffers se scatter, deles para buf caso contrário
+void _iovCopy(const VfsIovec* iov, int iovcnt, unsigned int pos, unsigned char* buf, unsigned int n, int scatter)
+{
+	for(int i = 0; i < iovcnt && n; i++) {
+		if(pos >= iov[i].len) {
+			pos -= iov[i].len;
+			continue;
+		}
+		unsigned int part = iov[i].len - pos < n ? iov[i].len - pos : n;
+		if(scatter) memcpy((unsigned char*) iov[i].base + pos, buf, part);
+		else memcpy(buf, (unsigned char*) iov[i].base + pos, part);
+		buf += part;
+		n -= part;
+		pos = 0;
+	}
+}
+
+//função que retorna presa a entrada do cache com o bloco de entrada entry
+//no mapa de um arquivo (0 ou reservado para um buraco). se não estiver,
+//o bloco é lido inteiro do disco para um buffer do cache, com os setores
+//indo direto para ele (buracos não são lidos). a entrada fica presa até
+//_bcachePut. retorna NULL em caso de erro ou se todas estiverem presas
+CachedBlock* _bcacheGet(unsigned int entry)
+{
+	unsigned int addr = entry & BLOCKADDR_UNWRITTEN ? 0 : BLOCKADDR(entry);
+
+	pthread_mutex_lock(&cacheLock);
+	CachedBlock* c = _bcacheFind(addr);
+	int hit = c != NULL;
+	if(!hit) c = _bcacheVictim(addr);
+	if(c != NULL) {
+		c->pins++;
+		c->lru = ++bcacheClock;
+	}
+	pthread_mutex_unlock(&cacheLock);
+	if(c == NULL || hit) return c;
+
+	//a entrada só fica válida depois de lida: até lá outras threads não a
+	//encontram e, se também lerem o bloco, usam outra entrada
+	int ret = 0;
+	if(addr == 0) memset(c->data, 0, c->size);
+	else if(BLOCKADDR_ZSECTORS(entry)) {
+		pthread_mutex_lock(&zLock);
+		unsigned char* z = _zBlockLoad(superblock.disk, entry);
+		if(z != NULL) memcpy(c->data, z, c->size);
+		else ret = -1;
+		pthread_mutex_unlock(&zLock);
+	} else ret = _dataRead(superblock.disk, addr, 0, c->data, c->size);
+
+	pthread_mutex_lock(&cacheLock);
+	if(ret == -1) c->pins--;
+	else if(_bcacheFind(addr) == NULL) {
+		c->valid = 1;
+		__atomic_add_fetch(&bcacheValid, 1, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&cacheLock);
+	return ret == -1 ? NULL : c;
+}
+
+//função que solta uma entrada presa por _bcacheGet
+void _bcachePut(CachedBlock* c)
+{
+	pthread_mutex_lock(&cacheLock);
+	c->pins--;
+	pthread_mutex_unlock(&cacheLock);
+}
+
+//função que lê do arquivo aberto file, a partir da posição pos, para a
+//sequência de iovcnt buffers iov, em uma única passagem pelo mapa de
+//blocos. os blocos vêm do cache (ver _bcacheGet), que só é travado para
+//procurar e prender a entrada: leituras de arquivos diferentes não
+//disputam nenhum lock além dele e do disco. deve ser chamada com o lock
+//do arquivo, ao menos compartilhado. retorna a quantidade lida, 0 no fim
+//do arquivo ou -1
+int _fileReadv(OpenFile* file, unsigned int pos, const VfsIovec* iov, int iovcnt)
+{
+	long total = _iovTotal(iov, iovcnt);
+	if(total == -1) return -1;
+	Inode* inode = file->inode;
+	unsigned int size = inodeGetFileSize(inode);
+	unsigned int nbytes = total;
+	if(pos >= size || nbytes == 0) return 0;
+	if(nbytes > size - pos) nbytes = size - pos;
+
+	//lê bloco a bloco; os buracos ocupam uma única entrada de zeros, sem
+	//nenhum acesso ao disco
+	if(_viewEnter(file->view) == -1) return -1;
+	unsigned int done = 0;
+	while(done < nbytes) {
+		unsigned int blockOff = (pos + done) % superblock.blockSize;
+		unsigned int n = superblock.blockSize - blockOff;
+		if(n > nbytes - done) n = nbytes - done;
+
+		CachedBlock* c = _bcacheGet(inodeGetBlockAddr(inode, (pos + done) / superblock.blockSize));
+		if(c == NULL) break;
+		_iovCopy(iov, iovcnt, done, &c->data[blockOff], n, 1);
+		_bcachePut(c);
+		done += n;
+	}
+	_viewLeave();
+	return done ? (int) done : -1;
+}
+
+//função que lê até nbytes bytes do arquivo aberto file a partir da
+//posição pos. deve ser chamada com o lock do arquivo, ao menos
+//compartilhado. retorna a quantidade lida, 0 no fim do arquivo ou -1
+int _fileRead(OpenFile* file, unsigned int pos, char* buf, unsigned int nbytes)
+{
+	VfsIovec iov = { buf, nbytes };
+	return _fileReadv(file, pos, &iov, 1);
+}
+
+//função que empresta o trecho do arquivo aberto file que começa na posição
+//pos e vai até o fim do seu bloco (ou do arquivo), dentro do buffer do
+//bloco no cache (ver _bcacheGet). *data aponta para o trecho, preso até
+//_fileRelease. deve ser chamada com o lock do arquivo, ao menos
+//compartilhado. retorna o tamanho do trecho, 0 no fim do arquivo ou -1
+int _fileBorrow(OpenFile* file, unsigned int pos, const char** data)
+{
+	Inode* inode = file->inode;
+	unsigned int size = inodeGetFileSize(inode);
+	if(pos >= size) return 0;
+	unsigned int blockOff = pos % superblock.blockSize;
+	unsigned int n = superblock.blockSize - blockOff;
+	if(n > size - pos) n = size - pos;
+
+	if(_viewEnter(file->view) == -1) return -1;
+	unsigned int entry = inodeGetBlockAddr(inode, pos / superblock.blockSize);
+	_viewLeave();
+
+	CachedBlock* c = _bcacheGet(entry);
+	if(c == NULL) return -1;
+	*data = (const char*) &c->data[blockOff];
+	return n;
+}
+
+//função que devolve um empréstimo de _fileBorrow, cujo trecho contém
+//data. retorna 0 ou -1 se data não estiver emprestado
+int _fileRelease(const char* data)
+{
+	int ret = -1;
+	const unsigned char* p = (const unsigned char*) data;
+	pthread_mutex_lock(&cacheLock);
+	for(int i = 0; i < BCACHE_BLOCKS && ret == -1; i++) {
+		CachedBlock* c = &bcache[i];
+		if(!c->pins || p < c->data || p >= c->data + c->size) continue;
+		c->pins--;
+		ret = 0;
+	}
+	pthread_mutex_unlock(&cacheLock);
+	return ret;
+}
+
+//função que diz se o bloco de entrada entry no mapa de um arquivo pode
+//ser sobrescrito no lugar sem allocLock: um bloco próprio, sem outras
+//referências, nem reservado nem comprimido, com a deduplicação e a
+//compressão desligadas. com a deduplicação, outra escrita poderia passar
+//a compartilhá-lo durante a escrita; sem ela, só snapshots e clones o
+//compartilham, com fsLock exclusivo. deve ser chamada com allocLock
+int _blockInPlace(unsigned int entry)
+{
+	if(superblock.flags & (MYFS_FLAG_DEDUP | MYFS_FLAG_COMPRESS)) return 0;
+	if(entry == 0 || (entry & BLOCKADDR_UNWRITTEN) || BLOCKADDR_ZSECTORS(entry)) return 0;
+	return _blockRefs(entry) == 0;
+}
+
+//função que escreve a sequência de iovcnt buffers iov no arquivo aberto
+//file a partir da posição pos, em uma única passagem pelo mapa de blocos
+//e uma única transação. os blocos que podem ser sobrescritos no lugar
+//(ver _blockInPlace) são escritos antes, só com o lock do arquivo; os
+//demais e o tamanho mudam depois, com allocLock. o trecho de um bloco
+//que vem de mais de um buffer é reunido antes em um bloco auxiliar. deve
+//ser chamada com o lock do arquivo exclusivo. retorna a quantidade
+//escrita ou -1
+int _fileWritev(OpenFile* file, unsigned int pos, const VfsIovec* iov, int iovcnt)
+{
+	long total = _iovTotal(iov, iovcnt);
+	if(file->view || total == -1) return -1; //snapshots são somente leitura
+	unsigned int nbytes = total;
+	if(nbytes == 0) return 0;
+	if(nbytes > UINT_MAX - pos) nbytes = UINT_MAX - pos;
+
+	Disk* d = superblock.disk;
+	Inode* inode = file->inode;
+	unsigned int first = pos / superblock.blockSize;
+	unsigned int count = (pos + nbytes - 1) / superblock.blockSize - first + 1;
+	unsigned int* map = malloc(count * sizeof(unsigned int));
+	unsigned char* inPlace = malloc(count);
+	if(map == NULL || inPlace == NULL) {
+		free(map);
+		free(inPlace);
+		return -1;
+	}
+
+	//o mapa é lido uma única vez, sem allocLock, que só é obtido para
+	//consultar as referências
+	for(unsigned int b = 0; b < count; b++) map[b] = inodeGetBlockAddr(inode, first + b);
+	pthread_mutex_lock(&allocLock);
+	for(unsigned int b = 0; b < count; b++) inPlace[b] = _blockInPlace(map[b]);
+	pthread_mutex_unlock(&allocLock);
+
+	unsigned char* scratch = NULL;
+	unsigned int done = 0, end = nbytes;
+	for(int locked = 0; locked <= 1; locked++) {
+		if(locked) {
+			pthread_mutex_lock(&allocLock);
+			journalBegin();
+		}
+		for(done = 0; done < end; ) {
+			unsigned int blockNum = (pos + done) / superblock.blockSize;
+			unsigned int blockOff = (pos + done) % superblock.blockSize;
+			unsigned int n = superblock.blockSize - blockOff;
+			if(n > end - done) n = end - done;
+			if(inPlace[blockNum - first] == locked) {
+				done += n;
+				continue;
+			}
+
+			unsigned char* src = _iovSpan(iov, iovcnt, done, n);
+			if(src == NULL) {
+				if(scratch == NULL && (scratch = malloc(superblock.blockSize)) == NULL) break;
+				_iovCopy(iov, iovcnt, done, scratch, n, 0);
+				src = scratch;
+			}
+			unsigned int addr = map[blockNum - first];
+			if(locked ? _fileWriteBlock(d, inode, blockNum, addr, blockOff, src, n) == -1 :
+				_dataWrite(d, addr, blockOff, src, n, 0) == -1) break;
+			done += n;
+		}
+		end = done;
+	}
+
+	int ret = done ? (int) done : -1;
+	if(pos + done > inodeGetFileSize(inode)) {
+		inodeSetFileSize(inode, pos + done);
+		if(inodeSave(inode) == -1) ret = -1;
+	}
+	if(_superBlockFlush(d) == -1) ret = -1;
+	journalEnd();
+	pthread_mutex_unlock(&allocLock);
+	free(scratch);
+	free(map);
+	free(inPlace);
+	return ret;
+}
+
+//função que escreve nbytes bytes de buf no arquivo aberto file a partir
+//da posição pos. deve ser chamada com o lock do arquivo exclusivo.
+//retorna a quantidade escrita ou -1
+int _fileWrite(OpenFile* file, unsigned int pos, const char* buf, unsigned int nbytes)
+{
+	VfsIovec iov = { (void*) buf, nbytes };
+	return _fileWritev(file, pos, &iov, 1);
+}
 
-//**************************************************
-// VARIÁVEIS GLOBAIS - CRIADAS PELOS ALUNOS
-//**************************************************
+//função que calcula a nova posição do cursor cursor de um arquivo aberto,
+//conforme whence (ver myFSSeek). deve ser chamada com o lock do arquivo,
+//ao menos compartilhado. retorna a posição ou -1
+long _fileSeek(OpenFile* file, unsigned int cursor, long offset, int whence)
+{
+	unsigned int size = inodeGetFileSize(file->inode);
+	long pos;
+	switch(whence) {
+		case MYFS_SEEK_SET: pos = offset; break;
+		case MYFS_SEEK_CUR: pos = (long) cursor + offset; break;
+		case MYFS_SEEK_END: pos = (long) size + offset; break;
+		case MYFS_SEEK_DATA:
+		case MYFS_SEEK_HOLE:
+			if(offset < 0 || offset >= size || _viewEnter(file->view) == -1) return -1;
+			pos = _fileSeekData(file->inode, offset, whence == MYFS_SEEK_DATA);
+			_viewLeave();
+			break;
+		default: return -1;
+	}
+	return pos < 0 || pos > INT_MAX ? -1 : pos;
+}
 
+//função que reserva blocos para o trecho de length bytes a partir de
+//offset do arquivo aberto file (ver myFSAllocate). deve ser chamada com o
+//lock do arquivo exclusivo. retorna 0 ou -1
+int _fileAllocate(OpenFile* file, unsigned int offset, unsigned int length, int flags)
+{
+	if(file->view || length == 0 || length > UINT_MAX - offset) return -1;
+	if(flags & ~MYFS_ALLOC_KEEP_SIZE) return -1;
 
-FSInfo* fileSystem;
+	Disk* d = superblock.disk;
+	Inode* inode = file->inode;
+	unsigned int first = offset / superblock.blockSize;
+	unsigned int count = (offset + length - 1) / superblock.blockSize - first + 1;
+	unsigned int* addrs = malloc(count * sizeof(unsigned int));
+	unsigned char* fresh = calloc(count, 1);
+	if(addrs == NULL || fresh == NULL) {
+		free(addrs);
+		free(fresh);
+		return -1;
+	}
 
-typedef struct files {
-	Inode* inode;
-	char name[MAX_FILE_LENGTH];
-	unsigned char* descriptor;
-	unsigned int isOpen; // 0 para fechado, 1 para aberto
-} FileDescriptor;
+	//blocos que já têm endereço ficam como estão
+	unsigned int holes = 0;
+	for(unsigned int b = 0; b < count; b++) {
+		addrs[b] = inodeGetBlockAddr(inode, first + b);
+		if(!addrs[b]) holes++;
+	}
 
-typedef struct directoryFileEntry {
-	char name[MAX_FILE_LENGTH];
-	unsigned int numInode;
-}DirectoryFileEntry;
+	//os buracos recebem, de preferência, uma única sequência contígua no
+	//grupo de cilindros do inode e, sem ela, blocos avulsos. o bitmap e o
+	//mapa de blocos são alterados em memória e gravados uma única vez
+	pthread_mutex_lock(&allocLock);
+	journalBegin();
+	int ret = holes <= superblock.freeBlocks ? 0 : -1;
+	unsigned int number = inodeGetNumber(inode);
+	int run = holes && ret == 0 ? _bitMapFindRun(holes, _inodeGroup(number) * superblock.groupBlocks) : -1;
+	for(unsigned int b = 0, k = 0; b < count && ret == 0; b++) {
+		if(addrs[b]) continue;
+		int block = run != -1 ? (int) _blockAddr(run + k++) : _blockAlloc(d, number);
+		if(block == -1 || (run != -1 && _bitMapSetFreePerBusy(block) == -1)) {
+			ret = -1;
+			break;
+		}
+		addrs[b] = block | BLOCKADDR_UNWRITTEN;
+		fresh[b] = 1;
+	}
+	if(ret == 0 && holes) ret = _inodeSetBlocks(inode, first, count, addrs);
+	if(ret == -1) {
+		for(unsigned int b = 0; b < count; b++) {
+			if(!fresh[b]) continue;
+			_bitMapSetBusyPerFree(BLOCKADDR(addrs[b]));
+			addrs[b] = 0;
+		}
+		//as extensões criadas para os buracos não podem ficar ligadas e zeradas
+		if(_inodeSetBlocks(inode, first, count, addrs) == 0) _inodeTrim(inode);
+	}
 
-typedef struct diretory {
-	DirectoryFileEntry* files;
-	int contRef;
-} Directory;
+	if(ret == 0 && !(flags & MYFS_ALLOC_KEEP_SIZE) && offset + length > inodeGetFileSize(inode)) {
+		inodeSetFileSize(inode, offset + length);
+		if(inodeSave(inode) == -1) ret = -1;
+	}
+	if(_superBlockFlush(d) == -1) ret = -1;
+	journalEnd();
+	pthread_mutex_unlock(&allocLock);
+	TRACE_DEBUG("allocate inode %u: %u blocos a partir do bloco %u, %u novos, sequência %d", number, count, first, holes, run);
 
-typedef struct superblock {
-	Inode* inodeRoot;
-	unsigned char* bitMap;
-	unsigned int totalBlocks;
-	unsigned int blockSize;
-	unsigned int sectorInit;
-	unsigned int sizeBitMap;
-	unsigned int blockRoot;
-} SuperBlock;
+	free(addrs);
+	free(fresh);
+	return ret;
+}
 
-SuperBlock superblock;
-Directory directory;
-FileDescriptor fileDescriptor[MAX_OPEN_FILES];
+//função que altera o tamanho do arquivo aberto file para length bytes
+//(ver myFSTruncate). deve ser chamada com o lock do arquivo exclusivo.
+//retorna 0 ou -1
+int _fileTruncate(OpenFile* file, unsigned int length)
+{
+	if(file->view) return -1; //snapshots são somente leitura
 
-//**************************************************
-// FUNÇÕES PRIVADAS - CRIADAS PELOS ALUNOS
-//**************************************************
+	Disk* d = superblock.disk;
+	Inode* inode = file->inode;
+	unsigned int size = inodeGetFileSize(inode);
+	unsigned int number = inodeGetNumber(inode);
+	unsigned int keep = (length + superblock.blockSize - 1) / superblock.blockSize;
 
-//função que retorna o numero de um bloco livre no disco
-//retorna o numero de bloco caso encontre
-//se não encontrar nenhum, retorna -1
-int _bitMapGetBlockFree(Disk* d)
+	pthread_mutex_lock(&allocLock);
+	journalBegin();
+	int ret = 0;
+	if(length < size) {
+		//zera o restante do último bloco mantido, que pode voltar a ser
+		//lido se o arquivo crescer de novo
+		unsigned int blockOff = length % superblock.blockSize;
+		if(blockOff) {
+			unsigned char* zeros = calloc(superblock.blockSize, 1);
+			if(zeros == NULL) ret = -1;
+			else {
+				unsigned int blockNum = length / superblock.blockSize;
+				ret = _fileWriteBlock(d, inode, blockNum, inodeGetBlockAddr(inode, blockNum),
+					blockOff, zeros, superblock.blockSize - blockOff);
+			}
+			free(zeros);
+		}
+		if(ret == 0) ret = _fileFree(d, number, keep, 0);
+
+		//o mapa de blocos foi alterado direto nos setores de inodes
+		Inode* fresh = ret == 0 ? inodeLoad(number, d) : NULL;
+		if(fresh == NULL) ret = -1;
+		else {
+			free(file->inode);
+			file->inode = inode = fresh;
+		}
+	}
+	if(ret == 0 && length != size) {
+		inodeSetFileSize(inode, length);
+		ret = inodeSave(inode);
+	}
+	if(_superBlockFlush(d) == -1) ret = -1;
+	journalEnd();
+	pthread_mutex_unlock(&allocLock);
+	return ret;
+}
+
+//função que acrescenta ao diretório aberto parent a entrada filename para
+//o arquivo regular inumber (ver myFSLink). deve ser chamada com nsLock.
+//retorna 0 ou -1
+int _dirLink(OpenFile* parent, const char* filename, unsigned int inumber)
 {
-	//procura algum bloco livre, se sim retorna a soma do bloco root mais o i do bitmap
-	for(int i = 0; i < superblock.sizeBitMap; i++) {
-		if(!superblock.bitMap[i]){
-			return superblock.blockRoot+i;
-		} 
+	if(strchr(filename, '/') != NULL) return -1;
+	if(parent->view) return -1; //snapshots são somente leitura
+	if(inumber < 1 || inumber > MAX_INODES) return -1;
+
+	Disk* d = superblock.disk;
+	unsigned int dirNumber = parent->number;
+	if(_dirLookup(d, dirNumber, filename)) return -1; //ja existe uma entrada com esse nome
+
+	//apenas arquivos regulares podem receber novos links. um arquivo
+	//aberto usa o inode do arquivo aberto, que precisa acompanhar o
+	//contador de referências
+	OpenFile* open = _openFileFind(inumber, 0);
+	Inode* target = open ? open->inode : inodeLoad(inumber, d);
+	if(target == NULL) return -1;
+	if(inodeGetFileType(target) != FILETYPE_REGULAR) {
+		if(!open) free(target);
+		return -1;
 	}
-	return -1;
+
+	if(open) pthread_rwlock_wrlock(&open->lock);
+	pthread_mutex_lock(&allocLock);
+	journalBegin();
+	int ret = -1;
+	Inode* dir = inodeLoad(dirNumber, d);
+	if(dir != NULL && _addDiretoryEntry(d, dir, filename, inumber, FILETYPE_REGULAR) == 0) {
+		free(parent->inode);
+		parent->inode = dir;
+		dir = NULL;
+
+		inodeSetRefCount(target, inodeGetRefCount(target) + 1);
+		ret = inodeSave(target);
+	}
+	if(_superBlockFlush(d) == -1) ret = -1;
+	journalEnd();
+	pthread_mutex_unlock(&allocLock);
+	if(open) pthread_rwlock_unlock(&open->lock);
+
+	free(dir);
+	if(!open) free(target);
+	return ret;
 }
 
-//função que coloca o bloco dado como ocupado
-void _bitMapSetFreePerBusy(int blockFree)
+//função que remove a entrada filename do diretório aberto parent (ver
+//myFSUnlink). deve ser chamada com nsLock. retorna 0 ou -1
+int _dirUnlink(OpenFile* parent, const char* filename)
 {
-	superblock.bitMap[blockFree - superblock.blockRoot] = 1; 
+	if(parent->view) return -1; //snapshots são somente leitura
+	if(!strcmp(filename, ".") || !strcmp(filename, "..")) return -1;
+
+	Disk* d = superblock.disk;
+	unsigned int dirNumber = parent->number;
+	unsigned int number = _dirLookup(d, dirNumber, filename);
+	if(!number) return -1;
+
+	//um arquivo aberto usa o inode do arquivo aberto, que precisa
+	//acompanhar o contador de referências
+	OpenFile* open = _openFileFind(number, 0);
+	Inode* target = open ? open->inode : inodeLoad(number, d);
+	if(target == NULL) return -1;
+
+	//diretórios só são removidos vazios e fechados
+	int ret = 0;
+	if(inodeGetFileType(target) == FILETYPE_DIR) ret = !open && _dirIsEmpty(d, target) == 1 ? 0 : -1;
+
+	if(open) pthread_rwlock_wrlock(&open->lock);
+	pthread_mutex_lock(&allocLock);
+	journalBegin();
+	Inode* dir = ret == 0 ? inodeLoad(dirNumber, d) : NULL;
+	if(dir == NULL || _removeDirectoryEntry(d, dir, filename) == -1) ret = -1;
+	else {
+		free(parent->inode);
+		parent->inode = dir;
+		dir = NULL;
+
+		//sem outras entradas, o arquivo é liberado agora ou, se estiver
+		//aberto, quando o último descritor for fechado
+		unsigned int refCount = inodeGetRefCount(target);
+		inodeSetRefCount(target, refCount > 1 ? refCount - 1 : 0);
+		if(refCount > 1 || open) ret = inodeSave(target);
+		else ret = _fileFree(d, number, 0, 1);
+
+		//as entradas guardadas do diretório removido deixam de valer
+		if(inodeGetFileType(target) == FILETYPE_DIR) dcacheInit();
+	}
+	if(_superBlockFlush(d) == -1) ret = -1;
+	journalEnd();
+	pthread_mutex_unlock(&allocLock);
+	if(open) pthread_rwlock_unlock(&open->lock);
+
+	free(dir);
+	if(!open) free(target);
+	return ret;
 }
 
-//função que coloca o bloco dado como desocupado
-void _bitMapSetBusyPerFree(int blockBusy)
+//função que liga (enabled diferente de 0) ou desliga a opção flag
+//(MYFS_FLAG_*) do volume montado no disco d, gravando o superbloco.
+//retorna 0 ou -1
+int _superBlockSetFlag(Disk* d, unsigned int flag, int enabled)
 {
-	superblock.bitMap[blockBusy - superblock.blockRoot] = 0; 
+	unsigned int flags = enabled ? superblock.flags | flag : superblock.flags & ~flag;
+	if(flags == superblock.flags) return 0;
+	superblock.flags = flags;
+	_superBlockDirty();
+
+	journalBegin();
+	int ret = _superBlockFlush(d);
+	journalEnd();
+	return ret;
 }
 
-//função que cria todos os inodes suportados no filesystema
-int _initInode(Disk *d)
+//função que retorna a fragmentação do arquivo path (ver myFSFragScore).
+//deve ser chamada com fsLock exclusivo. retorna -1 em caso de erro
+long _fragScore(Disk* d, const char* path)
 {
-	for(int i = 1; i <= MAX_INODES; i++) {
-		inodeCreate(i,d);
-		// if(inodeCreate(i,d) == NULL) {
-		// 	printf("\n retornou -1 no init inode");
-		// 	return -1;	
-	} 
-	return 0;
+	if(path == NULL) return -1;
+
+	unsigned int parent, number;
+	char name[MAX_FILE_LENGTH+1];
+	if(_pathWalk(d, path, &parent, name) == -1 || !name[0]) return -1;
+	if((number = _dirLookup(d, parent, name)) == 0) return -1;
+
+	OpenFile* open = _openFileFind(number, 0);
+	Inode* inode = open ? open->inode : inodeLoad(number, d);
+	if(inode == NULL) return -1;
+
+	unsigned long long bytes = 0;
+	for(unsigned int b = 0; b < _inodeNumBlocks(inode); b++) {
+		if(inodeGetBlockAddr(inode, b)) bytes += superblock.blockSize;
+	}
+	long score = bytes ? (long) ((unsigned long long) _fileCylinders(d, inode, NULL, 0, _inodeNumBlocks(inode)) * (1 << 20) / bytes) : 0;
+	if(!open) free(inode);
+	return score;
 }
 
-//função que inicializa o diretório raiz
-//lê os valores armazenados no superbloco 
-//e coloca nas variáveis globais. 
-//Tambem le o blockRoot e escreve no directory
-int _initDirRoot(Disk* d)
+//função que executa um passo do desfragmentador (ver myFSDefrag). deve
+//ser chamada com fsLock exclusivo. retorna os blocos movidos ou -1
+int _defrag(Disk* d, unsigned int maxBlocks, MyFSDefragStat* st)
 {
-	printf("etru dir\n");
-	unsigned char diskSuperBlock[DISK_SECTORDATASIZE] = {0};
-	
-	if(!directory.contRef) {
-		directory.files = malloc(sizeof(DirectoryFileEntry)*MAX_FILES);
-		if(directory.files == NULL) return -1;
+	MyFSDefragStat local;
+	if(st == NULL) st = &local;
+	memset(st, 0, sizeof(MyFSDefragStat));
+
+	//continua do inode e do bloco em que o passo anterior parou,
+	//percorrendo no máximo DEFRAG_SCAN_INODES inodes. um arquivo maior
+	//que o limite de blocos é movido em partes, ao longo de vários passos
+	int ret = 0;
+	for(unsigned int n = 0; n < DEFRAG_SCAN_INODES && ret != -1; n++) {
+		if(maxBlocks && st->blocksMoved >= maxBlocks) break;
+		unsigned int number = superblock.defragNext;
+		if(number < 1 || number > MAX_INODES) number = 1;
+
+		//um arquivo aberto usa o inode do arquivo aberto, que precisa
+		//acompanhar a troca dos endereços
+		OpenFile* open = _openFileFind(number, 0);
+		Inode* inode = open ? open->inode : inodeLoad(number, d);
+		if(inode == NULL) return -1;
+		unsigned int numBlocks = inodeGetFileType(inode) == FILETYPE_REGULAR ? _inodeNumBlocks(inode) : 0;
+		unsigned int first = superblock.defragBlock < numBlocks ? superblock.defragBlock : numBlocks;
+		unsigned int end = maxBlocks && numBlocks - first > maxBlocks - st->blocksMoved ? first + maxBlocks - st->blocksMoved : numBlocks;
+		if(inodeGetFileType(inode) == FILETYPE_REGULAR) st->filesScanned++;
+		unsigned int next = numBlocks;
+		if(first < end) {
+			ret = _defragFile(d, inode, first, end, &next, st);
+			if(ret > 0) superblock.defragIdle = 0;
+		}
+		if(!open) free(inode);
+
+		if(next < numBlocks) superblock.defragBlock = next;
+		else {
+			superblock.defragNext = number >= MAX_INODES ? 1 : number + 1;
+			superblock.defragBlock = 0;
+			superblock.defragIdle++;
+		}
 	}
-	
-	//lê o super blooc
-	if(diskReadSector(d,0,diskSuperBlock) == -1) return -1;
-	printf("leu superblokck\n");
-	
-	//passa os valores para as variáveis globais
-	char2ul(&diskSuperBlock[INDEX_TOTALBLOCKS], &superblock.totalBlocks);
-	char2ul(&diskSuperBlock[INDEX_BLOCKSIZE], &superblock.blockSize);
-	char2ul(&diskSuperBlock[INDEX_SECTOR_INIT], &superblock.sectorInit);
-	char2ul(&diskSuperBlock[INDEX_SIZE_BITMAP], &superblock.sizeBitMap);
-	char2ul(&diskSuperBlock[INDEX_BLOCK_ROOT], &superblock.blockRoot);
-	printf("transformou dados\n");
-	
-	superblock.bitMap = malloc(superblock.sizeBitMap);
-	memcpy(superblock.bitMap, &diskSuperBlock[INDEX_BITMAP], superblock.sizeBitMap);
-	printf("copiou bitmap\n");
-	
-	superblock.inodeRoot = inodeLoad(ID_INODE_DEFAULT, d);
-	printf("leu inode root\n");
-	
-	//lê o root
-	unsigned char* diskSectorRoot = malloc(DISK_SECTORDATASIZE * (superblock.blockSize/DISK_SECTORDATASIZE));
-	memset(diskSectorRoot,0,sizeof(diskSectorRoot));
-	
-	for(int i = 0; i < superblock.blockSize/DISK_SECTORDATASIZE; i++) {
-		if(diskReadSector(d,superblock.sectorInit-1+i,diskSectorRoot) == -1) return -1;
+	st->complete = superblock.defragIdle >= MAX_INODES;
+	return ret == -1 ? -1 : (int) st->blocksMoved;
+}
+
+//função que verifica e, com repair, corrige o sistema de arquivos (ver
+//myFSCheck). deve ser chamada com fsLock exclusivo. retorna as
+//inconsistências encontradas ou -1
+int _check(Disk* d, int repair, unsigned int numThreads, MyFSCheckStat* st)
+{
+	if(fdTable.openCount) return -1;
+	MyFSCheckStat local;
+	if(st == NULL) st = &local;
+	memset(st, 0, sizeof(MyFSCheckStat));
+	if(!numThreads) numThreads = CHECK_THREADS;
+	if(numThreads > CHECK_MAX_THREADS) numThreads = CHECK_MAX_THREADS;
+
+	//o que ainda está só em memória vai para o journal, de onde é lido
+	journalBegin();
+	int ret = _superBlockFlush(d);
+	journalEnd();
+
+	Check c;
+	CheckWorker workers[CHECK_MAX_THREADS];
+	memset(&c, 0, sizeof(Check));
+	memset(workers, 0, sizeof(workers));
+	c.workers = workers;
+	c.numThreads = numThreads;
+	c.repair = repair;
+	c.inodes = malloc(MAX_INODES * RAWINODE_WORDS * sizeof(unsigned int));
+	c.inodeDirty = calloc(MAX_INODES + 1, 1);
+	c.owner = calloc(MAX_INODES + 1, sizeof(unsigned int));
+	c.dirFirst = calloc(MAX_INODES + 1, sizeof(unsigned int));
+	c.dirCount = calloc(MAX_INODES + 1, sizeof(unsigned int));
+	c.dirDotDot = calloc(MAX_INODES + 1, sizeof(unsigned int));
+	c.dirDotDotPos = calloc(MAX_INODES + 1, sizeof(unsigned int));
+	if(!c.inodes || !c.inodeDirty || !c.owner || !c.dirFirst || !c.dirCount || !c.dirDotDot || !c.dirDotDotPos) ret = -1;
+	for(unsigned int t = 0; t < numThreads; t++) {
+		workers[t].c = &c;
+		workers[t].id = t;
+		workers[t].refs = calloc(superblock.sizeBitMap, sizeof(unsigned short));
+		if(workers[t].refs == NULL) ret = -1;
 	}
 
-	//faz o split dos dados lidos e armazena na variável global
-	char* token = strtok(diskSectorRoot, "/,");
-	int x = 0;
-	while(token != NULL) {		
-		if((*token >= 48) && (*token <= 57)) { // verifica se a string é numérica
-			directory.files[x/2].numInode = *token - '0';
-		} else {
-			strcpy(directory.files[x/2].name, token);
-		}
+	//os metadados são lidos uma única vez, em ordem crescente de setor, e
+	//conferidos em memória: primeiro as cadeias de extensões e os
+	//diretórios, que decidem o que está em uso, depois as referências aos
+	//blocos e, por fim, o bitmap e as tabelas
+	if(ret == 0) ret = _checkReadInodes(d, &c, workers[0].refs, st);
+	if(ret == 0 && _checkInode(c.inodes, ID_INODE_DEFAULT)[RAWINODE_TYPE] != FILETYPE_DIR) {
+		TRACE_ERROR("fsck: o inode da raiz não é um diretório");
+		ret = -1;
+	}
+	if(ret == 0) {
+		_checkChains(&c, st);
+		ret = _checkDirBlocks(&c, st);
+	}
+	if(ret == 0) ret = _checkReadDirs(d, &c);
+	if(ret == 0) ret = _checkRun(workers, numThreads, _checkDirsWorker);
+	if(ret == 0) ret = _checkLinks(&c, workers, st);
+	if(ret == 0) ret = _checkRun(workers, numThreads, _checkInodesWorker);
+	if(ret == 0) ret = _checkRun(workers, numThreads, _checkBlocksWorker);
 
-		token = strtok(NULL, "/,");
+	for(unsigned int t = 0; t < numThreads; t++) {
+		st->dirEntries += workers[t].st.dirEntries;
+		st->blocksUsed += workers[t].st.blocksUsed;
+		st->badBlockAddrs += workers[t].st.badBlockAddrs;
+		st->badEntries += workers[t].st.badEntries;
+		st->badBlocks += workers[t].st.badBlocks;
+		st->unrepairable += workers[t].st.unrepairable;
+	}
+	for(unsigned int n = 1; ret == 0 && n <= MAX_INODES; n++) {
+		if(c.owner[n]) st->inodesUsed++;
+	}
 
-		x += 1;
+	//contadores do superbloco
+	if(ret == 0) {
+		unsigned int blockRoot = BLOCKADDR(_checkInode(c.inodes, ID_INODE_DEFAULT)[0]);
+		if(superblock.freeBlocks != superblock.sizeBitMap - st->blocksUsed ||
+			superblock.freeInodes != MAX_INODES - st->inodesUsed || superblock.blockRoot != blockRoot) {
+			TRACE_WARN("fsck: superbloco com %u blocos e %u inodes livres, encontrados %u e %u", superblock.freeBlocks,
+				superblock.freeInodes, superblock.sizeBitMap - st->blocksUsed, MAX_INODES - st->inodesUsed);
+			st->badCounters++;
+			if(repair) {
+				superblock.freeBlocks = superblock.sizeBitMap - st->blocksUsed;
+				superblock.freeInodes = MAX_INODES - st->inodesUsed;
+				superblock.blockRoot = blockRoot;
+			}
+		}
 	}
-	
-	directory.contRef = x/2; // porque o x sempre será o dobro da quantidade de dados no diretorio
 
-	return 0;
+	unsigned int found = st->badBlockAddrs + st->badChains + st->badEntries + st->badLinks +
+		st->orphans + st->badBlocks + st->badCounters + st->unrepairable;
+	if(ret == 0 && repair && found > st->unrepairable) {
+		ret = _checkWrite(d, &c);
 
+		//as dicas de alocação e as caches (entradas de diretório, bloco
+		//comprimido e índice de deduplicação) são refeitas do zero
+		if(ret == 0) ret = _unmount(d);
+		if(ret == 0) ret = _mount(d);
+	}
+	_checkFree(&c, workers);
+	TRACE_INFO("fsck: %u inconsistências, %u inodes e %u blocos em uso", found, st->inodesUsed, st->blocksUsed);
+	return ret == 0 ? (int) found : -1;
 }
 
-//função que cria o diretório raiz
-//cria um bloco de dados correspondente ao 
-//primeiro bloco livre do disco e salva o inode
-//retorna o numero do bloco caso de sucesso
-//e -1 caso contrário
-int _createDirRoot(Disk* d)
+//função que cria dstPath como um clone de srcPath (ver myFSClone). deve
+//ser chamada com fsLock exclusivo. retorna 0 ou -1
+int _clone(Disk* d, const char* srcPath, const char* dstPath)
 {
-	directory.contRef = 0;//(apagar talvez)
+	if(d == NULL || srcPath == NULL || dstPath == NULL) return -1;
 
-	//pega o id do inode default e seta ele como arquivo de diretório
-	inodeSetFileType(inodeLoad(ID_INODE_DEFAULT, d), 1); // 0 para arquivo regular, 1 para diretório
-	
-	//cria um novo bloco na lista de blocos do inode
-	int idBlock = inodeAddBlock(inodeLoad(ID_INODE_DEFAULT, d),0); //colocando o bloco inicial como sendo o zero, tudo o que vem antes está sendo contado somente como setores
-	printf("id do block root: %d\n", idBlock);
-	if(idBlock == -1) return -1;
-	
-	// pega o bloco correspondente ao id do bloco criado
-	unsigned int blockRoot =  inodeGetBlockAddr(inodeLoad(ID_INODE_DEFAULT, d),idBlock); 
-	printf("num do block root: %d\n", superblock.blockRoot);
-	if(inodeSave(inodeLoad(ID_INODE_DEFAULT, d)) == -1) return -1;
+	unsigned int srcParent, dstParent, number;
+	char srcName[MAX_FILE_LENGTH+1], dstName[MAX_FILE_LENGTH+1];
+	if(_pathWalk(d, srcPath, &srcParent, srcName) == -1 || !srcName[0]) return -1;
+	if(_pathWalk(d, dstPath, &dstParent, dstName) == -1 || !dstName[0]) return -1;
+	if(_dirLookup(d, dstParent, dstName) != 0) return -1;
+	if((number = _dirLookup(d, srcParent, srcName)) == 0) return -1;
 
-	return blockRoot;
+	//um arquivo aberto usa o inode do arquivo aberto, que tem o mapa de
+	//blocos e o tamanho atuais
+	OpenFile* open = _openFileFind(number, 0);
+	Inode* src = open ? open->inode : inodeLoad(number, d);
+	if(src == NULL) return -1;
 
-}
+	//confere antes de criar a entrada que ha referencias e extensoes de
+	//inode suficientes, para que o clone nao fique pela metade
+	unsigned int numBlocks = _inodeNumBlocks(src);
+	unsigned int numExt = 0;
+	if(numBlocks > inodeNumDirectBlocks()) {
+		numExt = (numBlocks - inodeNumDirectBlocks() + inodeNumBlocksPerExtension() - 1) / inodeNumBlocksPerExtension();
+	}
+	int ret = inodeGetFileType(src) == FILETYPE_REGULAR && superblock.freeInodes > numExt ? 0 : -1;
+	for(unsigned int b = 0; ret == 0 && b < numBlocks; b++) {
+		unsigned int addr = BLOCKADDR(inodeGetBlockAddr(src, b));
+		if(addr && _blockRefs(addr) >= REFCOUNT_MAX) ret = -1;
+	}
 
-//função que cria uma nova entrada 
-//no diretório raiz. retorna -1 caso de mal sucedico
-//e 0 caso feito com sucesso
-int _addDiretoryEntry(Disk* d, const char* filename, Inode* inode)
-{
-	char aux[DISK_SECTORDATASIZE] = {0};
-	unsigned char aux2[DISK_SECTORDATASIZE] = {0};
-	
-	for(int i = 0; i < directory.contRef; i++) {
-		if(!strcmp(directory.files[i].name, filename)) return -1; //ja existe um arquivo com esse nome
+	journalBegin();
+	Inode* dst = ret == 0 ? _createEntry(d, dstParent, dstName, FILETYPE_REGULAR) : NULL;
+	if(dst == NULL) ret = -1;
+
+	unsigned int b = 0;
+	for(; ret == 0 && b < numBlocks; b++) {
+		//a entrada é copiada inteira: o clone também lê o bloco comprimido
+		unsigned int entry = inodeGetBlockAddr(src, b);
+		if(!entry) continue;
+		if(_blockGet(BLOCKADDR(entry)) == -1) ret = -1;
+		else if(_inodeSetBlock(dst, b, entry) == -1) {
+			_blockPut(BLOCKADDR(entry));
+			ret = -1;
+		}
 	}
-		
-	strcpy(directory.files[directory.contRef].name, filename);
-	directory.files[directory.contRef].numInode = inodeGetNumber(inode);
-	printf("name depois de adicionado: %s\n", directory.files[directory.contRef].name);
-
-	int sizeEntry = snprintf(NULL,0, "%d,%s/", directory.files[directory.contRef].numInode, directory.files[directory.contRef].name);
-	for(int i = 0; i <= directory.contRef; i++) {
-		char* dataEntry = malloc(sizeEntry + 1); // soma mais um pq o snprintf não conta o \0 no final da string
-		sprintf(dataEntry, "%d,%s/", directory.files[i].numInode, directory.files[i].name);
-		// asprintf(&dataEntry, "%d,%s/", directory.files[directory.contRef].numInode, directory.files[directory.contRef].name);
-		printf("data entry: %s", dataEntry);
-		strcat(aux, dataEntry);
-		free(dataEntry);
+
+	if(ret == 0) {
+		inodeSetFileSize(dst, inodeGetFileSize(src));
+		if(inodeSave(dst) == -1) ret = -1;
+	} else if(dst != NULL) {
+		//falha de E/S no meio da copia do mapa: o clone fica vazio
+		while(b-- > 0) {
+			unsigned int addr = BLOCKADDR(inodeGetBlockAddr(dst, b));
+			if(addr) {
+				inodeSetBlockAddr(dst, b, 0);
+				_blockPut(addr);
+			}
+		}
+		_inodeTrim(dst);
 	}
-	
-	printf("aux: %s\n", aux);
-	
-	int sectorAdd = (superblock.blockSize/DISK_SECTORDATASIZE)*superblock.blockRoot + superblock.sectorInit;
-	printf("setor add: %d\n", sectorAdd);
+	if(_superBlockFlush(d) == -1) ret = -1;
+	journalEnd();
 
+	TRACE_DEBUG("clone '%s' -> '%s': %u blocos, ret %d", srcPath, dstPath, numBlocks, ret);
+	if(dst != NULL) free(dst);
+	if(!open) free(src);
+	return ret;
+}
 
-	if(diskWriteSector(d,sectorAdd,aux) == -1) return -1;
+//função que remove o snapshot id do disco d (ver myFSSnapshotDelete).
+//deve ser chamada com fsLock exclusivo. retorna 0 ou -1
+int _snapshotDelete(Disk* d, int id)
+{
+	if(d == NULL || superblock.disk != d || id < 1 || id > MAX_SNAPSHOTS) return -1;
+	if(!superblock.snapshots[id-1]) return -1;
+	for(unsigned int b = 0; b < fdTable.numBuckets; b++) {
+		for(OpenFile* f = fdTable.buckets[b]; f != NULL; f = f->hashNext) {
+			if(f->view == (unsigned int) id) return -1;
+		}
+	}
 
-	// printf("escreveu\n");
-	// if(diskReadSector(d,sectorAdd,aux2) == -1) return -1;
-	
-	// printf("string lida: %s\n", aux2);
-	// // for(int i = 0; i < 10; i++) {
-	// // 	printf("leu3\n");
-	// // 	printf("teste: 0x%02X\n", aux[i]);
-		
-	// // }
+	journalBegin();
+	int ret = _viewEnter(id);
+	if(ret == 0) {
+		ret = _inodeTableRefBlocks(d, 0, MAX_INODES + 1);
+		_viewLeave();
+	}
+	if(ret == 0) {
+		unsigned int numCopies = (_inodeTableSectors() + _sectorsPerBlock() - 1) / _sectorsPerBlock();
+		for(unsigned int i = 0; i < numCopies; i++) _blockPut(view.map[i]);
+		_blockPut(superblock.snapshots[id-1]);
+		superblock.snapshots[id-1] = 0;
+		_superBlockDirty();
+	}
+	if(_superBlockFlush(d) == -1) ret = -1;
+	journalEnd();
+	return ret;
+}
 
-	// // diskGetSize
+//função que abre o caminho path do snapshot id (ver myFSSnapshotOpen).
+//deve ser chamada com nsLock. retorna o descritor ou -1
+int _snapshotOpen(Disk* d, int id, const char* path)
+{
+	if(id < 1 || id > MAX_SNAPSHOTS || _viewEnter(id) == -1) return -1;
 
-	directory.contRef += 1;
-	
-	return 0;
+	int fd = -1;
+	unsigned int parent;
+	char name[MAX_FILE_LENGTH+1];
+	if(_pathWalk(d, path, &parent, name) == 0) {
+		unsigned int number = name[0] ? _dirLookup(d, parent, name) : ID_INODE_DEFAULT;
+		OpenFile* file = number ? _openFileFind(number, id) : NULL;
+		if(file != NULL) file->refCount++;
+		else if(number) {
+			Inode* inode = inodeLoad(number, d);
+			if(inode != NULL && (file = _openFileInsert(inode)) == NULL) free(inode);
+		}
+		if(file != NULL && (fd = _fdAlloc(file)) == -1) _openFilePut(file);
+	}
 
+	_viewLeave();
+	return fd;
 }
 
 //**************************************************
@@ -263,13 +4083,28 @@ int _addDiretoryEntry(Disk* d, const char* filename, Inode* inode)
 //se nao ha quisquer descritores de arquivos em uso atualmente. Retorna
 //um positivo se ocioso ou, caso contrario, 0.
 int myFSIsIdle (Disk *d) {
-	for(int i = 0; i < MAX_OPEN_FILES; i++) {
-		if(fileDescriptor[i].isOpen) {
-			return 0;
-		}
-	}
+	return __atomic_load_n(&fdTable.openCount, __ATOMIC_ACQUIRE) == 0;
+}
 
-	return 1;
+//Funcao que monta o sistema de arquivos do disco d, lendo apenas o
+//superbloco. Retorna 0 se bem sucedido ou -1 caso contrario
+int myFSMount (Disk *d) {
+	if(d == NULL) return -1;
+	pthread_rwlock_wrlock(&fsLock);
+	int ret = _mount(d);
+	if(ret == 0) superblock.pinned = d;
+	pthread_rwlock_unlock(&fsLock);
+	return ret;
+}
+
+//Funcao que grava o estado pendente do disco d e o marca como desmontado
+//corretamente. Nao pode haver arquivos abertos. Retorna 0 ou -1
+int myFSUnmount (Disk *d) {
+	pthread_rwlock_wrlock(&fsLock);
+	int ret = _unmount(d);
+	if(ret == 0 && superblock.pinned == d) superblock.pinned = NULL;
+	pthread_rwlock_unlock(&fsLock);
+	return ret;
 }
 
 //Funcao para formatacao de um disco com o novo sistema de arquivos
@@ -277,51 +4112,10 @@ int myFSIsIdle (Disk *d) {
 //blocos disponiveis no disco, se formatado com sucesso. Caso contrario,
 //retorna -1.
 int myFSFormat (Disk *d, unsigned int blockSize) {
-	if(d != NULL) {
-		unsigned char diskSuperBlock[DISK_SECTORDATASIZE] = {0};
-		// unsigned char aux[DISK_SECTORDATASIZE] = {0};
-		unsigned char clearSectores[DISK_SECTORDATASIZE] = {0};
-		
-		//limpa os setores
-		for(int i = 0; i < diskGetNumSectors(d); i++) {
-			if(diskWriteSector(d,i,clearSectores) == -1) return -1;
-		}
-
-		//armazena o valor total de blocos no super bloco
-		unsigned int totalBlocks = diskGetSize(d) / blockSize;
-		ul2char(totalBlocks, &diskSuperBlock[INDEX_TOTALBLOCKS]);
-		
-		//armazena o valor do blocksize no super bloco 
-		ul2char(blockSize, &diskSuperBlock[INDEX_BLOCKSIZE]);
-
-		//calcula quantos setores será necessário para armazenar todos os inodes e qual o primeiro setor livre
-		unsigned int sizeInodeSpace = MAX_INODES/inodeNumInodesPerSector(); //1024/8 = 128 setores
-		unsigned int sectorInit = sizeInodeSpace+NUM_SECTOR_INIT_INODE; // 128 + 2 = 130
-		ul2char(sectorInit, &diskSuperBlock[INDEX_SECTOR_INIT]);
-		
-		//cria todos os inodes e armazena no disco
-		if(_initInode(d) == -1) return -1;
-		//cria o diretorio raiz e um bloco de dados e armazena no superbloco o bloco do diretorio raiz
-		unsigned int blockRoot = _createDirRoot(d);
-		if(blockRoot == -1) return -1;
-		ul2char(blockRoot, &diskSuperBlock[INDEX_BLOCK_ROOT]);
-		
-		//armazena o tamanho bitmap dos blocos livres no superbloco | 256 blocos - 128/(1024/512) = 256 - 64 = 192 blocos
-																			//    128+2/(1024/512) = 256 - 65 = 191 blocos
-		unsigned int tamBitMap = (totalBlocks - ((sizeInodeSpace+NUM_SECTOR_INIT_INODE)/(blockSize/DISK_SECTORDATASIZE))); //calcula quantos bits serao necessarios para armazenar os blocos livres
-		ul2char(tamBitMap, &diskSuperBlock[INDEX_SIZE_BITMAP]);
-		
-		unsigned char* bitMap = malloc(tamBitMap);
-		memset(bitMap,0,tamBitMap);
-		bitMap[0] = 1; // marca como ocupado o primeiro bloco correspondente ao diretório raiz 
-		memcpy(&diskSuperBlock[INDEX_BITMAP], bitMap, tamBitMap); //copia os dados do bitmap pro superblock
-		
-		//escreve no setor zero o superbloco
-		if(diskWriteSector(d,0,diskSuperBlock) == -1) return -1;
-		
-		return totalBlocks > 0 ? totalBlocks : -1;
-	}
-	return -1;
+	pthread_rwlock_wrlock(&fsLock);
+	int ret = _format(d, blockSize);
+	pthread_rwlock_unlock(&fsLock);
+	return ret;
 }
 
 //Funcao para abertura de um arquivo, a partir do caminho especificado
@@ -329,117 +4123,228 @@ int myFSFormat (Disk *d, unsigned int blockSize) {
 //criando o arquivo se nao existir. Retorna um descritor de arquivo,
 //em caso de sucesso. Retorna -1, caso contrario.
 int myFSOpen (Disk *d, const char *path) {
-	if(d == NULL || path == NULL) return -1;
-
-	if(superblock.bitMap == NULL) {
-		printf("inicializou root");
-		if(_initDirRoot(d) == -1) return -1;
+	if(d == NULL || path == NULL || _fsEnter(d, 0) == -1) return -1;
+	pthread_mutex_lock(&nsLock);
+	int fd = _openPath(d, path, FILETYPE_REGULAR);
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return fd;
+}
+	
+//Funcao para a leitura de um arquivo, a partir de um descritor de
+//arquivo existente. Os dados lidos sao copiados para buf e terao
+//tamanho maximo de nbytes. Retorna o numero de bytes efetivamente
+//lidos em caso de sucesso ou -1, caso contrario.
+int myFSRead (int fd, char *buf, unsigned int nbytes) {
+	if(buf == NULL) return -1;
+	_fsEnter(NULL, 0);
+	int ret = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 1);
+	if(f != NULL) {
+		pthread_rwlock_rdlock(&f->file->lock);
+		ret = _fileRead(f->file, f->cursor, buf, nbytes);
+		pthread_rwlock_unlock(&f->file->lock);
+		if(ret > 0) f->cursor += ret;
+		_fdUnlock(f);
 	}
+	_fsLeave();
+	return ret;
+}
 
-	printf("iniciou dir\n");
-	
-	int descriptorIndex = -1;
-	int auxVerify = 0; //0 o arquivo não existe, 1 existe
-	
-	for(int i = 0; i < MAX_OPEN_FILES; i++) {
-		if(!fileDescriptor[i].isOpen) {
-			descriptorIndex = i;
-			break;
-		}
+//Funcao para a escrita de um arquivo, a partir de um descritor de
+//arquivo existente. Os dados de buf serao copiados para o disco e
+//terao tamanho maximo de nbytes. Retorna o numero de bytes
+//efetivamente escritos em caso de sucesso ou -1, caso contrario
+int myFSWrite (int fd, const char *buf, unsigned int nbytes) {
+	if(buf == NULL) return -1;
+	_fsEnter(NULL, 0);
+	int ret = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 1);
+	if(f != NULL) {
+		pthread_rwlock_wrlock(&f->file->lock);
+		ret = _fileWrite(f->file, f->cursor, buf, nbytes);
+		pthread_rwlock_unlock(&f->file->lock);
+		if(ret > 0) f->cursor += ret;
+		_fdUnlock(f);
 	}
+	_fsLeave();
+	return ret;
+}
 
-	//verifica se o arquivo ja está aberto(arrumar)
-	for(int i = 0; i < MAX_OPEN_FILES; i++) {
-		if(!strcmp(fileDescriptor[i].name, path)) return -1;
+//Funcao para a leitura de nbytes bytes de um arquivo aberto a partir da
+//posicao offset, sem usar nem alterar o cursor. Leituras posicionais do
+//mesmo descritor sao feitas em paralelo. Retorna o numero de bytes lidos,
+//0 no fim do arquivo ou -1 caso contrario
+int myFSPRead (int fd, char *buf, unsigned int nbytes, unsigned int offset) {
+	if(buf == NULL) return -1;
+	_fsEnter(NULL, 0);
+	int ret = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 0);
+	if(f != NULL) {
+		pthread_rwlock_rdlock(&f->file->lock);
+		ret = _fileRead(f->file, offset, buf, nbytes);
+		pthread_rwlock_unlock(&f->file->lock);
+		_fdUnlock(f);
 	}
-		
-	//verifica se o filename ja existe
-	for(int i = 0; i < directory.contRef; i++) {
-		printf("name: %s\n", directory.files[i].name);
-		printf("path: %s\n", path);
-		if(!strcmp(directory.files[i].name, path)) {
-			printf("entrou id igual\n");
-			auxVerify = 1;
-			break;
-		}
+	_fsLeave();
+	return ret;
+}
+
+//Funcao para a escrita de nbytes bytes de buf em um arquivo aberto a
+//partir da posicao offset, sem usar nem alterar o cursor. Retorna o numero
+//de bytes escritos ou -1 caso contrario
+int myFSPWrite (int fd, const char *buf, unsigned int nbytes, unsigned int offset) {
+	if(buf == NULL) return -1;
+	_fsEnter(NULL, 0);
+	int ret = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 0);
+	if(f != NULL) {
+		pthread_rwlock_wrlock(&f->file->lock);
+		ret = _fileWrite(f->file, offset, buf, nbytes);
+		pthread_rwlock_unlock(&f->file->lock);
+		_fdUnlock(f);
 	}
+	_fsLeave();
+	return ret;
+}
 
-	//caso não tenha esse arquivo, então cria
-	if(!auxVerify) {
-		//pega um inode criado
-		fileDescriptor[descriptorIndex].inode = inodeLoad(inodeFindFreeInode(ID_INODE_DEFAULT,d),d);
-		printf("inode pegado: %s\n", inodeGetNumber(fileDescriptor[descriptorIndex].inode));
-		if(fileDescriptor[descriptorIndex].inode == NULL) return -1;
-	
-		printf("\npegou o inode\n");
-		if(_addDiretoryEntry(d,path,fileDescriptor[descriptorIndex].inode) == -1) return -1;
+//Funcao para a leitura de um arquivo aberto, a partir do cursor, para a
+//sequencia de iovcnt buffers iov, preenchidos em ordem. Os blocos sao
+//mapeados uma unica vez para todos os buffers. Retorna o numero de bytes
+//lidos, 0 no fim do arquivo ou -1 caso contrario
+int myFSReadv (int fd, const VfsIovec *iov, int iovcnt) {
+	_fsEnter(NULL, 0);
+	int ret = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 1);
+	if(f != NULL) {
+		pthread_rwlock_rdlock(&f->file->lock);
+		ret = _fileReadv(f->file, f->cursor, iov, iovcnt);
+		pthread_rwlock_unlock(&f->file->lock);
+		if(ret > 0) f->cursor += ret;
+		_fdUnlock(f);
 	}
-	
-	
-	// //pega o numero do bloco livre
-	// int blockFree = _bitMapGetBlockFree(d);
-	// if(blockFree == -1) return -1;
-
-	// // seta o tipo para arquivo regular (0 para arquivo regular e 1 para diretório)
-	// inodeSetFileType(fileDescriptor[descriptorIndex].inode, 0); 
-	// int idBlock = inodeAddBlock(fileDescriptor[descriptorIndex].inode,blockFree); //cria um novo bloco na lista de blocos do inode
-	// if(idBlock == -1) return -1;
-	// _bitMapSetFreePerBusy(blockFree); //coloca o bloco como ocupado
-	
-	strcpy(fileDescriptor[descriptorIndex].name, path);
-	fileDescriptor[descriptorIndex].descriptor = "r+"; //abre para leitura e escrita
-	fileDescriptor[descriptorIndex].isOpen = 1;
-	
-	return descriptorIndex+1;
+	_fsLeave();
+	return ret;
 }
-	
-//Funcao para a leitura de um arquivo, a partir de um descritor de
-//arquivo existente. Os dados lidos sao copiados para buf e terao
-//tamanho maximo de nbytes. Retorna o numero de bytes efetivamente
-//lidos em caso de sucesso ou -1, caso contrario.
-int myFSRead (int fd, char *buf, unsigned int nbytes) {
-	// if (fd < 0 || fd >= MAX_OPEN_FILES || buf == NULL){
-	// 	return -1; // parametro invalido
-	// }
 
-	// if (!fileDescriptor[fd].isOpen){
-	// 	return -1; // arquivo não aberto
-	// }
+//Funcao para a escrita, a partir do cursor de um arquivo aberto, da
+//sequencia de iovcnt buffers iov, em ordem, em uma unica passagem pelo
+//mapa de blocos e uma unica transacao. Retorna o numero de bytes escritos
+//ou -1 caso contrario
+int myFSWritev (int fd, const VfsIovec *iov, int iovcnt) {
+	_fsEnter(NULL, 0);
+	int ret = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 1);
+	if(f != NULL) {
+		pthread_rwlock_wrlock(&f->file->lock);
+		ret = _fileWritev(f->file, f->cursor, iov, iovcnt);
+		pthread_rwlock_unlock(&f->file->lock);
+		if(ret > 0) f->cursor += ret;
+		_fdUnlock(f);
+	}
+	_fsLeave();
+	return ret;
+}
 
-	// unsigned long sectorAddr = inodeGetBlockAddr(fileDescriptor[fd].inode, 0);
-	// unsigned char sectorData[DISK_SECTORDATASIZE];
+//Funcao que empresta, somente para leitura, o trecho de um arquivo aberto
+//que comeca na posicao offset e vai ate o fim do seu bloco, sem copia-lo
+//para um buffer do chamador. *data aponta para o buffer do bloco no cache,
+//que fica preso e com o conteudo do momento do emprestimo ate
+//myFSRelease. Emprestimos do mesmo bloco compartilham o buffer. O cursor
+//nao muda. Retorna o tamanho do trecho, 0 no fim do arquivo ou -1
+int myFSBorrow (int fd, unsigned int offset, const char **data) {
+	if(data == NULL) return -1;
+	_fsEnter(NULL, 0);
+	int ret = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 0);
+	if(f != NULL) {
+		pthread_rwlock_rdlock(&f->file->lock);
+		ret = _fileBorrow(f->file, offset, data);
+		pthread_rwlock_unlock(&f->file->lock);
+		_fdUnlock(f);
+	}
+	_fsLeave();
+	return ret;
+}
 
-	// if (d == NULL){
-	// 	return -1; // disco não está montado
-	// }
+//Funcao que devolve o trecho data emprestado por myFSBorrow. Retorna 0
+//caso bem sucedido ou -1 caso contrario
+int myFSRelease (int fd, const char *data) {
+	if(data == NULL || _fdEntry(fd) == NULL) return -1;
+	_fsEnter(NULL, 0);
+	int ret = _fileRelease(data);
+	_fsLeave();
+	return ret;
+}
 
-	// if (diskReadSector(d, sectorAddr, sectorData) != 0){
-	// 	return -1; // Falha na leitura do setor
-	// }
+//Funcao que posiciona o cursor de um arquivo aberto. whence indica a
+//referencia do deslocamento offset: MYFS_SEEK_SET (inicio), MYFS_SEEK_CUR
+//(posicao atual) ou MYFS_SEEK_END (fim). MYFS_SEEK_DATA e MYFS_SEEK_HOLE
+//posicionam no primeiro dado ou buraco a partir de offset. Retorna a nova
+//posicao ou -1 caso contrario
+int myFSSeek (int fd, long offset, int whence) {
+	_fsEnter(NULL, 0);
+	long pos = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 1);
+	if(f != NULL) {
+		pthread_rwlock_rdlock(&f->file->lock);
+		pos = _fileSeek(f->file, f->cursor, offset, whence);
+		pthread_rwlock_unlock(&f->file->lock);
+		if(pos != -1) f->cursor = pos;
+		_fdUnlock(f);
+	}
+	_fsLeave();
+	return pos;
+}
 
-	// strncpy(buf, sectorData, nbytes);
-	// return nbytes; // Concluído!
+//Funcao que reserva blocos para o trecho de length bytes a partir de offset
+//de um arquivo aberto. Os buracos do trecho recebem, de preferencia, uma
+//unica sequencia contigua de blocos, marcados como nao escritos: sao lidos
+//como zeros sem acesso ao disco e a primeira escrita grava no lugar
+//reservado. Sem MYFS_ALLOC_KEEP_SIZE em flags, o arquivo passa a ter ao
+//menos offset + length bytes. Retorna 0 ou -1 caso contrario
+int myFSAllocate (int fd, unsigned int offset, unsigned int length, int flags) {
+	_fsEnter(NULL, 0);
+	int ret = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 0);
+	if(f != NULL) {
+		pthread_rwlock_wrlock(&f->file->lock);
+		ret = _fileAllocate(f->file, offset, length, flags);
+		pthread_rwlock_unlock(&f->file->lock);
+		_fdUnlock(f);
+	}
+	_fsLeave();
+	return ret;
 }
 
-//Funcao para a escrita de um arquivo, a partir de um descritor de
-//arquivo existente. Os dados de buf serao copiados para o disco e
-//terao tamanho maximo de nbytes. Retorna o numero de bytes
-//efetivamente escritos em caso de sucesso ou -1, caso contrario
-int myFSWrite (int fd, const char *buf, unsigned int nbytes) {
-	return -1;
+//Funcao que altera o tamanho de um arquivo aberto para length bytes. Ao
+//diminuir, os blocos alem do novo fim (inclusive os reservados) sao
+//liberados em lote e o restante do ultimo bloco passa a ser lido como
+//zeros; ao aumentar, o trecho novo e' um buraco. O cursor nao muda.
+//Retorna 0 ou -1 caso contrario
+int myFSTruncate (int fd, unsigned int length) {
+	_fsEnter(NULL, 0);
+	int ret = -1;
+	FileDescriptor* f = _fdLock(fd, FILETYPE_REGULAR, 0);
+	if(f != NULL) {
+		pthread_rwlock_wrlock(&f->file->lock);
+		ret = _fileTruncate(f->file, length);
+		pthread_rwlock_unlock(&f->file->lock);
+		_fdUnlock(f);
+	}
+	_fsLeave();
+	return ret;
 }
 
 //Funcao para fechar um arquivo, a partir de um descritor de arquivo
 //existente. Retorna 0 caso bem sucedido, ou -1 caso contrario
 int myFSClose (int fd) {
-	if(fd <= 0) return -1;
-
-	strcpy(fileDescriptor[fd-1].name, "");
-	fileDescriptor[fd-1].descriptor = "";
-	fileDescriptor[fd-1].inode = NULL;
-	fileDescriptor[fd-1].isOpen = 0;
-
-	return 0;
+	_fsEnter(NULL, 0);
+	pthread_mutex_lock(&nsLock);
+	int ret = _fdRelease(fd, FILETYPE_REGULAR);
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return ret;
 }
 
 //Funcao para abertura de um diretorio, a partir do caminho
@@ -447,7 +4352,12 @@ int myFSClose (int fd) {
 //criando o diretorio se nao existir. Retorna um descritor de arquivo,
 //em caso de sucesso. Retorna -1, caso contrario.
 int myFSOpenDir (Disk *d, const char *path) {
-	return -1;
+	if(d == NULL || path == NULL || _fsEnter(d, 0) == -1) return -1;
+	pthread_mutex_lock(&nsLock);
+	int fd = _openPath(d, path, FILETYPE_DIR);
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return fd;
 }
 
 //Funcao para a leitura de um diretorio, identificado por um descritor
@@ -458,7 +4368,59 @@ int myFSOpenDir (Disk *d, const char *path) {
 //Retorna 1 se uma entrada foi lida, 0 se fim de diretorio ou -1 caso
 //mal sucedido
 int myFSReadDir (int fd, char *filename, unsigned int *inumber) {
-	return -1;
+	if(filename == NULL || inumber == NULL) return -1;
+	_fsEnter(NULL, 0);
+	pthread_mutex_lock(&nsLock);
+	int ret = -1;
+	FileDescriptor* f = _fdGet(fd, FILETYPE_DIR);
+	if(f != NULL && _viewEnter(f->file->view) == 0) {
+		ret = _dirReadEntry(f, filename, inumber);
+		_viewLeave();
+	}
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return ret;
+}
+
+//Funcao para a leitura de um lote de entradas de um diretorio aberto, a
+//partir da posicao *cookie (0 no inicio), sem usar o cursor. As entradas
+//sao copiadas para buf como registros VfsDirent, tantas quantas couberem
+//em nbytes, e *cookie passa a indicar onde o proximo lote comeca. Retorna
+//os bytes copiados, 0 no fim do diretorio ou -1 caso contrario
+int myFSGetdents (int fd, char *buf, unsigned int nbytes, unsigned int *cookie) {
+	if(buf == NULL || cookie == NULL) return -1;
+	_fsEnter(NULL, 0);
+	pthread_mutex_lock(&nsLock);
+	int ret = -1;
+	FileDescriptor* f = _fdGet(fd, FILETYPE_DIR);
+	if(f != NULL && _viewEnter(f->file->view) == 0) {
+		ret = _dirGetdents(f->file, cookie, buf, nbytes, 0);
+		_viewLeave();
+	}
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return ret;
+}
+
+//Funcao para a leitura de ate max entradas de um diretorio aberto, a
+//partir da posicao *cookie (0 no inicio), junto com o tipo, o tamanho, o
+//proprietario e a permissao de cada uma. Os setores de i-nodes sao lidos
+//em ordem crescente, uma unica vez cada. *cookie passa a indicar onde o
+//proximo lote comeca. Retorna a quantidade de entradas, 0 no fim do
+//diretorio ou -1 caso contrario
+int myFSReaddirPlus (int fd, VfsDirentPlus *entries, unsigned int max, unsigned int *cookie) {
+	if(entries == NULL || cookie == NULL) return -1;
+	_fsEnter(NULL, 0);
+	pthread_mutex_lock(&nsLock);
+	int ret = -1;
+	FileDescriptor* f = _fdGet(fd, FILETYPE_DIR);
+	if(f != NULL && _viewEnter(f->file->view) == 0) {
+		ret = _dirReaddirPlus(f->file, cookie, entries, max);
+		_viewLeave();
+	}
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return ret;
 }
 
 //Funcao para adicionar uma entrada a um diretorio, identificado por um
@@ -466,7 +4428,14 @@ int myFSReadDir (int fd, char *filename, unsigned int *inumber) {
 //por filename e apontara' para o numero de i-node indicado por inumber.
 //Retorna 0 caso bem sucedido, ou -1 caso contrario.
 int myFSLink (int fd, const char *filename, unsigned int inumber) {
-	return -1;
+	if(filename == NULL) return -1;
+	_fsEnter(NULL, 0);
+	pthread_mutex_lock(&nsLock);
+	FileDescriptor* f = _fdGet(fd, FILETYPE_DIR);
+	int ret = f != NULL ? _dirLink(f->file, filename, inumber) : -1;
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return ret;
 }
 
 //Funcao para remover uma entrada existente em um diretorio, 
@@ -474,13 +4443,160 @@ int myFSLink (int fd, const char *filename, unsigned int inumber) {
 //identificada pelo nome indicado em filename. Retorna 0 caso bem
 //sucedido, ou -1 caso contrario.
 int myFSUnlink (int fd, const char *filename) {
-	return -1;
+	if(filename == NULL) return -1;
+	_fsEnter(NULL, 0);
+	pthread_mutex_lock(&nsLock);
+	FileDescriptor* f = _fdGet(fd, FILETYPE_DIR);
+	int ret = f != NULL ? _dirUnlink(f->file, filename) : -1;
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return ret;
 }
 
 //Funcao para fechar um diretorio, identificado por um descritor de
 //arquivo existente. Retorna 0 caso bem sucedido, ou -1 caso contrario.	
 int myFSCloseDir (int fd) {
-	return -1;
+	_fsEnter(NULL, 0);
+	pthread_mutex_lock(&nsLock);
+	int ret = _fdRelease(fd, FILETYPE_DIR);
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return ret;
+}
+
+//Funcao que ativa (enabled diferente de 0) ou desativa a compressao dos
+//blocos de dados gravados a partir de agora no disco d. Blocos ja gravados
+//continuam como estao ate serem reescritos. Retorna 0 ou -1
+int myFSSetCompression (Disk *d, int enabled) {
+	if(d == NULL || _fsEnter(d, 1) == -1) return -1;
+
+	//a quantidade de setores comprimidos divide a entrada do mapa com o
+	//endereço do bloco
+	int ret = -1;
+	if(!enabled || (diskGetNumSectors(d) <= BLOCKADDR_MASK && _sectorsPerBlock() <= BLOCKADDR_ZSECTORS_MAX)) {
+		ret = _superBlockSetFlag(d, MYFS_FLAG_COMPRESS, enabled);
+	}
+	_fsLeave();
+	return ret;
+}
+
+//Funcao que ativa (enabled diferente de 0) ou desativa a deduplicacao dos
+//blocos de dados gravados inteiros a partir de agora no disco d. Retorna 0
+//ou -1
+int myFSSetDedup (Disk *d, int enabled) {
+	if(d == NULL || _fsEnter(d, 1) == -1) return -1;
+	int ret = _superBlockSetFlag(d, MYFS_FLAG_DEDUP, enabled);
+	_fsLeave();
+	return ret;
+}
+
+//Funcao que retorna a fragmentacao do arquivo path: cilindros cruzados
+//por MiB na sua leitura sequencial. Retorna -1 em caso de erro
+long myFSFragScore (Disk *d, const char *path) {
+	if(d == NULL || _fsEnter(d, 1) == -1) return -1;
+	long ret = _fragScore(d, path);
+	_fsLeave();
+	return ret;
+}
+
+//Funcao que executa um passo do desfragmentador no disco d, movendo no
+//maximo maxBlocks blocos (0 sem limite). Retorna a quantidade de blocos
+//movidos ou -1
+int myFSDefrag (Disk *d, unsigned int maxBlocks, MyFSDefragStat *st) {
+	if(d == NULL || _fsEnter(d, 1) == -1) return -1;
+	int ret = _defrag(d, maxBlocks, st);
+	_fsLeave();
+	return ret;
+}
+
+//Funcao que verifica a consistencia do sistema de arquivos do disco d com
+//numThreads threads e, com repair diferente de 0, corrige o que for
+//possivel. Retorna a quantidade de inconsistencias encontradas ou -1
+int myFSCheck (Disk *d, int repair, unsigned int numThreads, MyFSCheckStat *st) {
+	if(d == NULL || _fsEnter(d, 1) == -1) return -1;
+	int ret = _check(d, repair, numThreads, st);
+	_fsLeave();
+	return ret;
+}
+
+//Funcao que cria o arquivo dstPath como um clone do arquivo srcPath: o
+//novo i-node aponta para os mesmos blocos de dados, que passam a ter uma
+//referencia a mais e sao copiados quando um dos arquivos os altera
+//(copy-on-write). Retorna 0 ou -1 caso contrario
+int myFSClone (Disk *d, const char *srcPath, const char *dstPath) {
+	if(d == NULL || srcPath == NULL || dstPath == NULL || _fsEnter(d, 1) == -1) return -1;
+	int ret = _clone(d, srcPath, dstPath);
+	_fsLeave();
+	return ret;
+}
+
+//Funcao que cria um snapshot somente leitura do sistema de arquivos do
+//disco d. O snapshot guarda uma copia da area de i-nodes e compartilha
+//todos os blocos de dados e de diretorios, que passam a ser copiados na
+//proxima alteracao (copy-on-write). Retorna o identificador do snapshot
+//(1 a MYFS_MAX_SNAPSHOTS) ou -1 caso contrario
+int myFSSnapshotCreate (Disk *d) {
+	if(d == NULL || _fsEnter(d, 1) == -1) return -1;
+
+	int id = 0;
+	for(int i = 0; i < MAX_SNAPSHOTS && !id; i++) {
+		if(!superblock.snapshots[i]) id = i + 1;
+	}
+	if(!id) {
+		_fsLeave();
+		return -1;
+	}
+
+	journalBegin();
+	int ret = _snapshotCreate(d, id);
+	if(_superBlockFlush(d) == -1) ret = -1;
+	journalEnd();
+
+	//o snapshot só existe depois de confirmado no journal
+	if(ret == 0 && journalSync() == -1) ret = -1;
+	_fsLeave();
+	return ret == 0 ? id : -1;
+}
+
+//Funcao que remove o snapshot id do disco d, devolvendo os blocos que so
+//ele usava. Nao pode haver arquivos do snapshot abertos. Retorna 0 ou -1
+int myFSSnapshotDelete (Disk *d, int id) {
+	if(d == NULL || _fsEnter(NULL, 1) == -1) return -1;
+	int ret = _snapshotDelete(d, id);
+	_fsLeave();
+	return ret;
+}
+
+//Funcao que abre, somente para leitura, o arquivo ou diretorio do caminho
+//path como ele estava no snapshot id do disco d. O descritor e' usado com
+//as funcoes de leitura, posicionamento e fechamento do tipo do arquivo.
+//Retorna o descritor ou -1 caso contrario
+int myFSSnapshotOpen (Disk *d, int id, const char *path) {
+	if(d == NULL || path == NULL || _fsEnter(d, 0) == -1) return -1;
+	pthread_mutex_lock(&nsLock);
+	int fd = _snapshotOpen(d, id, path);
+	pthread_mutex_unlock(&nsLock);
+	_fsLeave();
+	return fd;
+}
+
+//Funcao que preenche st com as estatisticas do sistema de arquivos do disco
+//d, sem percorrer o bitmap. Retorna 0 se bem sucedido ou -1 caso contrario
+int myFSStatFS (Disk *d, MyFSStat *st) {
+	if(d == NULL || st == NULL || _fsEnter(d, 0) == -1) return -1;
+	pthread_mutex_lock(&allocLock);
+
+	st->blockSize = superblock.blockSize;
+	st->totalBlocks = superblock.sizeBitMap;
+	st->freeBlocks = superblock.freeBlocks;
+	st->totalInodes = MAX_INODES;
+	st->freeInodes = superblock.freeInodes;
+	st->compressIn = superblock.zIn;
+	st->compressOut = superblock.zOut;
+	st->dedupHits = superblock.dedupHits;
+	pthread_mutex_unlock(&allocLock);
+	_fsLeave();
+	return 0;
 }
 
 //Funcao para instalar seu sistema de arquivos no S.O., registrando-o junto
@@ -504,6 +4620,17 @@ int installMyFS (void) {
 	fileSystem->linkFn = myFSLink;
 	fileSystem->unlinkFn = myFSUnlink;
 	fileSystem->closedirFn = myFSCloseDir;
+	fileSystem->mountFn = myFSMount;
+	fileSystem->unmountFn = myFSUnmount;
+	fileSystem->preadFn = myFSPRead;
+	fileSystem->pwriteFn = myFSPWrite;
+	fileSystem->seekFn = myFSSeek;
+	fileSystem->readvFn = myFSReadv;
+	fileSystem->writevFn = myFSWritev;
+	fileSystem->borrowFn = myFSBorrow;
+	fileSystem->releaseFn = myFSRelease;
+	fileSystem->getdentsFn = myFSGetdents;
+	fileSystem->readdirplusFn = myFSReaddirPlus;
 	
 	if(fileSystem->fsname == NULL || fileSystem->isidleFn == NULL || 
 		fileSystem->formatFn == NULL || fileSystem->openFn == NULL || fileSystem->readFn == NULL || 
@@ -14,6 +14,199 @@
 
 #include "vfs.h"
 
+//As funcoes deste arquivo podem ser chamadas por varias threads ao mesmo
+//tempo; as leituras de arquivos diferentes prosseguem em paralelo
+
+//Estatisticas de ocupacao do sistema de arquivos, obtidas diretamente dos
+//contadores do superbloco
+typedef struct myfs_stat {
+	unsigned int blockSize;
+	unsigned int totalBlocks; //blocos da area de dados
+	unsigned int freeBlocks;
+	unsigned int totalInodes;
+	unsigned int freeInodes;
+	unsigned long long compressIn; //bytes de blocos gravados com a compressao ativa desde a montagem
+	unsigned long long compressOut; //bytes (setores inteiros) efetivamente gravados para eles
+	unsigned long long dedupHits; //blocos nao gravados desde a montagem por ja existirem no disco
+} MyFSStat;
+
+//Referencias de deslocamento para myFSSeek
+#define MYFS_SEEK_SET 0 //inicio do arquivo
+#define MYFS_SEEK_CUR 1 //posicao atual
+#define MYFS_SEEK_END 2 //fim do arquivo
+#define MYFS_SEEK_DATA 3 //primeira posicao com dados a partir de offset
+#define MYFS_SEEK_HOLE 4 //primeira posicao em um buraco (ou o fim) a partir de offset
+
+//Funcoes que leem e escrevem nbytes bytes do arquivo aberto fd a partir
+//da posicao offset, sem usar nem alterar o cursor: varias threads podem
+//ler o mesmo descritor em paralelo. Retornam a quantidade de bytes lidos
+//(0 no fim do arquivo) ou escritos, ou -1 caso contrario
+int myFSPRead ( int fd, char *buf, unsigned int nbytes, unsigned int offset );
+int myFSPWrite ( int fd, const char *buf, unsigned int nbytes, unsigned int offset );
+
+//Funcoes que leem para (ou escrevem a partir de) iovcnt buffers iov, em
+//ordem, a partir do cursor do arquivo aberto fd, em uma unica passagem
+//pelo mapa de blocos. Retornam a quantidade de bytes lidos (0 no fim do
+//arquivo) ou escritos, ou -1 caso contrario
+int myFSReadv ( int fd, const VfsIovec *iov, int iovcnt );
+int myFSWritev ( int fd, const VfsIovec *iov, int iovcnt );
+
+//Funcao que empresta, somente para leitura e sem copia para o chamador, o
+//trecho do arquivo aberto fd que vai da posicao offset ate o fim do seu
+//bloco, diretamente do cache de blocos do sistema de arquivos: um bloco
+//ja no cache e' emprestado sem acesso ao disco. *data continua valido, e
+//o bloco preso no cache, ate myFSRelease. Retorna o tamanho do trecho, 0
+//no fim do arquivo ou -1
+int myFSBorrow ( int fd, unsigned int offset, const char **data );
+
+//Funcao que devolve o trecho data emprestado por myFSBorrow. Retorna 0 ou -1
+int myFSRelease ( int fd, const char *data );
+
+//Funcao que copia para buf, como registros VfsDirent, tantas entradas do
+//diretorio aberto fd quantas couberem em nbytes, a partir da posicao
+//*cookie (0 no inicio), que passa a indicar o proximo lote. Os setores do
+//diretorio sao lidos em ordem, uma unica vez. Retorna os bytes copiados, 0
+//no fim do diretorio ou -1
+int myFSGetdents ( int fd, char *buf, unsigned int nbytes, unsigned int *cookie );
+
+//Funcao que copia para entries ate max entradas do diretorio aberto fd, a
+//partir da posicao *cookie (0 no inicio), com o tipo, o tamanho, o
+//proprietario e a permissao de cada uma, lendo os setores de i-nodes em
+//ordem crescente, uma unica vez cada. *cookie passa a indicar o proximo
+//lote. Retorna a quantidade de entradas, 0 no fim do diretorio ou -1
+int myFSReaddirPlus ( int fd, VfsDirentPlus *entries, unsigned int max, unsigned int *cookie );
+
+//Funcao que posiciona o cursor de um arquivo aberto. Arquivos podem ter
+//buracos: blocos nunca escritos, lidos como zeros e sem espaco ocupado.
+//Retorna a nova posicao ou -1 caso contrario
+int myFSSeek ( int fd, long offset, int whence );
+
+//Opcoes de myFSAllocate
+#define MYFS_ALLOC_KEEP_SIZE 1 //nao altera o tamanho do arquivo
+
+//Funcao que reserva espaco para o trecho de length bytes a partir de offset
+//do arquivo aberto fd, de preferencia em blocos contiguos. Os blocos
+//reservados sao lidos como zeros ate serem escritos. Sem
+//MYFS_ALLOC_KEEP_SIZE em flags, o arquivo cresce ate offset + length
+//bytes. Retorna 0 se bem sucedido ou -1 caso contrario
+int myFSAllocate ( int fd, unsigned int offset, unsigned int length, int flags );
+
+//Funcao que altera o tamanho do arquivo aberto fd para length bytes. Os
+//blocos alem do novo fim sao liberados; o trecho acrescentado e' lido
+//como zeros. Retorna 0 se bem sucedido ou -1 caso contrario
+int myFSTruncate ( int fd, unsigned int length );
+
+//Funcao que monta o sistema de arquivos do disco d, lendo apenas o
+//superbloco. O MyFS guarda o estado de um unico disco: enquanto d estiver
+//montado, a montagem, a formatacao e as operacoes de outros discos falham
+//ate myFSUnmount (d). Retorna 0 se bem sucedido ou -1 caso contrario
+int myFSMount ( Disk *d );
+
+//Funcao que grava o estado pendente do disco d e o marca como desmontado
+//corretamente. Nao pode haver arquivos abertos. Retorna 0 ou -1
+int myFSUnmount ( Disk *d );
+
+//Funcao que ativa (enabled diferente de 0) ou desativa a compressao dos
+//blocos de dados gravados a partir de agora no disco d. Blocos comprimidos
+//ocupam menos setores no disco, o que reduz o tempo de transferencia; o
+//espaco reservado continua sendo de um bloco. A opcao fica gravada no
+//superbloco. Retorna 0 ou -1
+int myFSSetCompression ( Disk *d, int enabled );
+
+//Funcao que ativa (enabled diferente de 0) ou desativa a deduplicacao no
+//disco d. Com ela, cada bloco de dados gravado inteiro tem seu conteudo
+//identificado por um hash e conferido byte a byte com os blocos ja
+//indexados: um bloco repetido passa a ser compartilhado (copy-on-write)
+//em vez de gravado, e um bloco de zeros vira um buraco. Blocos gravados
+//em partes ou comprimidos nao sao deduplicados. A opcao fica gravada no
+//superbloco. Retorna 0 ou -1
+int myFSSetDedup ( Disk *d, int enabled );
+
+//Resultado de um passo do desfragmentador
+typedef struct myfs_defrag_stat {
+	unsigned int filesScanned;
+	unsigned int filesMoved;
+	unsigned int blocksMoved;
+	unsigned long cylindersBefore; //cilindros cruzados na leitura dos trechos movidos, antes
+	unsigned long cylindersAfter; //e depois de movidos: a diferenca e' a distancia de busca economizada
+	unsigned int complete; //1 se uma volta inteira pelos i-nodes nao moveu nenhum bloco
+} MyFSDefragStat;
+
+//Funcao que retorna a fragmentacao do arquivo path do disco d, em
+//cilindros cruzados por MiB na sua leitura sequencial, ou -1
+long myFSFragScore ( Disk *d, const char *path );
+
+//Funcao que executa um passo do desfragmentador no disco d, com o sistema
+//em uso. Os arquivos regulares sao percorridos a partir do i-node e do
+//bloco em que o passo anterior parou, em trechos de ate maxBlocks blocos
+//(0 sem limite: o arquivo inteiro). Cada trecho cuja leitura cruzaria
+//menos cilindros e' movido para uma sequencia contigua de blocos livres,
+//de preferencia logo depois do trecho anterior, trocando os enderecos do
+//mapa em uma unica transacao. Blocos compartilhados (com snapshots, clones
+//ou deduplicados) nao sao movidos. O passo termina depois de mover
+//maxBlocks blocos ou de percorrer 64 i-nodes; um arquivo maior que o
+//limite continua no proximo passo. Se st nao for NULL, recebe o resultado
+//do passo (st->complete indica que nao ha mais o que melhorar). Retorna a
+//quantidade de blocos movidos ou -1
+int myFSDefrag ( Disk *d, unsigned int maxBlocks, MyFSDefragStat *st );
+
+//Resultado da verificacao de consistencia
+typedef struct myfs_check_stat {
+	unsigned int inodesUsed; //i-nodes em uso, inclusive extensoes
+	unsigned int dirEntries; //entradas de diretorio verificadas
+	unsigned int blocksUsed; //blocos de dados referenciados
+	unsigned int badBlockAddrs; //enderecos de bloco invalidos ou alem do tamanho do arquivo
+	unsigned int badChains; //extensoes de i-node invalidas, compartilhadas ou perdidas
+	unsigned int badEntries; //entradas de diretorio corrompidas ou para i-nodes invalidos
+	unsigned int badLinks; //contadores de referencias de i-nodes incorretos
+	unsigned int orphans; //arquivos e diretorios inalcancaveis a partir da raiz
+	unsigned int badBlocks; //blocos com bitmap, referencias ou impressao digital incorretos
+	unsigned int badCounters; //campos do superbloco incorretos
+	unsigned int unrepairable; //inconsistencias que a correcao nao resolve (ex.: nos snapshots)
+} MyFSCheckStat;
+
+//Funcao que verifica a consistencia do sistema de arquivos do disco d: os
+//mapas de blocos e as extensoes dos i-nodes, as entradas de diretorio, os
+//contadores de referencias, o bitmap e os contadores do superbloco. A area
+//de i-nodes e os diretorios sao lidos inteiros, na ordem do disco, e
+//conferidos em memoria por numThreads threads (0 para o padrao). Com
+//repair diferente de 0, as inconsistencias corrigiveis sao corrigidas em
+//uma transacao: i-nodes inalcancaveis sao liberados e o bitmap e os
+//contadores sao refeitos a partir do que esta em uso. Nao pode haver
+//arquivos abertos. Se st nao for NULL, recebe o relatorio. Retorna a
+//quantidade de inconsistencias encontradas (0 se consistente) ou -1
+int myFSCheck ( Disk *d, int repair, unsigned int numThreads, MyFSCheckStat *st );
+
+//Funcao que cria o arquivo dstPath (que nao pode existir) como um clone
+//do arquivo srcPath, compartilhando os mesmos blocos de dados. O custo e'
+//proporcional aos metadados e nenhum bloco de dados e' ocupado ate que um
+//dos arquivos seja alterado (copy-on-write). Retorna 0 ou -1
+int myFSClone ( Disk *d, const char *srcPath, const char *dstPath );
+
+//Quantidade maxima de snapshots mantidos ao mesmo tempo em um disco
+#define MYFS_MAX_SNAPSHOTS 8
+
+//Funcao que cria um snapshot somente leitura do sistema de arquivos do
+//disco d, compartilhando com ele todos os blocos (copy-on-write). O custo
+//e' proporcional aos metadados, nao aos dados. Retorna o identificador do
+//snapshot (1 a MYFS_MAX_SNAPSHOTS) ou -1 caso contrario
+int myFSSnapshotCreate ( Disk *d );
+
+//Funcao que remove o snapshot id do disco d, devolvendo os blocos que so
+//ele usava. Nao pode haver arquivos do snapshot abertos. Retorna 0 ou -1
+int myFSSnapshotDelete ( Disk *d, int id );
+
+//Funcao que abre, somente para leitura, o arquivo ou diretorio do caminho
+//path como ele estava no snapshot id. O descritor e' usado com myFSRead,
+//myFSSeek e myFSClose (arquivos) ou myFSReadDir e myFSCloseDir
+//(diretorios), inclusive enquanto o sistema ativo continua sendo alterado.
+//Retorna o descritor ou -1 caso contrario
+int myFSSnapshotOpen ( Disk *d, int id, const char *path );
+
+//Funcao que preenche st com as estatisticas do sistema de arquivos do disco
+//d, sem percorrer o bitmap. Retorna 0 se bem sucedido ou -1 caso contrario
+int myFSStatFS ( Disk *d, MyFSStat *st );
+
 //Funcao para instalar seu sistema de arquivos no S.O., registrando-o junto
 //ao virtual FS (vfs). Retorna um identificador unico (slot), caso
 //o sistema de arquivos tenha sido registrado com sucesso.
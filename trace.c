@@ -0,0 +1,79 @@
+/*
+*  trace.c - Rastreamento (tracing) do MyFS habilitado em tempo de compilacao
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include "trace.h"
+
+#ifdef MYFS_TRACE_RING
+TraceEvent traceRing[TRACE_RING_SIZE];
+unsigned long long traceRingCount; //total de eventos ja registrados
+#endif
+
+//função que retorna o instante atual em nanossegundos
+unsigned long long _traceNow(void)
+{
+	struct timespec ts;
+	if(!timespec_get(&ts, TIME_UTC)) return 0;
+	return (unsigned long long) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+//Funcao que escreve em stderr uma mensagem de rastreamento
+void traceText(int level, const char* fmt, ...)
+{
+	static const char* names[] = { "", "ERROR", "WARN", "INFO", "DEBUG" };
+	va_list args;
+
+	fprintf(stderr, "[myfs %s] ", level >= TRACE_LEVEL_ERROR && level <= TRACE_LEVEL_DEBUG ? names[level] : "?");
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+//Funcao que acrescenta um evento ao buffer circular
+void traceRingAdd(unsigned int op, unsigned int inode, unsigned int sector)
+{
+#ifdef MYFS_TRACE_RING
+	//várias threads podem registrar eventos ao mesmo tempo
+	TraceEvent* e = &traceRing[__atomic_fetch_add(&traceRingCount, 1, __ATOMIC_RELAXED) & (TRACE_RING_SIZE - 1)];
+	e->time = _traceNow();
+	e->op = op;
+	e->inode = inode;
+	e->sector = sector;
+	e->pad = 0;
+#else
+	(void) op;
+	(void) inode;
+	(void) sector;
+#endif
+}
+
+//Funcao que grava os eventos do buffer circular no arquivo path
+int traceRingDump(const char* path)
+{
+#ifdef MYFS_TRACE_RING
+	unsigned long long first = traceRingCount > TRACE_RING_SIZE ? traceRingCount - TRACE_RING_SIZE : 0;
+	unsigned int count = traceRingCount - first;
+
+	FILE* f = fopen(path, "wb");
+	if(f == NULL) return -1;
+	int ok = fwrite("MTRC", 1, 4, f) == 4 && fwrite(&count, sizeof(count), 1, f) == 1;
+	for(unsigned long long i = first; ok && i < traceRingCount; i++) {
+		ok = fwrite(&traceRing[i & (TRACE_RING_SIZE - 1)], sizeof(TraceEvent), 1, f) == 1;
+	}
+	if(fclose(f) != 0 || !ok) return -1;
+	return count;
+#else
+	(void) path;
+	return -1;
+#endif
+}
@@ -0,0 +1,97 @@
+/*
+*  trace.h - Rastreamento (tracing) do MyFS habilitado em tempo de compilacao
+*
+*  Autores: Quezia Emanuelly da Silva Oliveira
+*  Projeto: Trabalho Pratico II - Sistemas Operacionais
+*  Organizacao: Universidade Federal de Juiz de Fora
+*  Departamento: Dep. Ciencia da Computacao
+*
+*  Por padrao nenhuma chamada de rastreamento e' compilada. Para habilitar:
+*    -DMYFS_TRACE_LEVEL=n  mensagens de texto em stderr ate o nivel n
+*                          (1 erro, 2 aviso, 3 info, 4 depuracao)
+*    -DMYFS_TRACE_RING     eventos binarios em um buffer circular em memoria,
+*                          gravados em arquivo por traceRingDump
+*
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_LEVEL_ERROR 1
+#define TRACE_LEVEL_WARN 2
+#define TRACE_LEVEL_INFO 3
+#define TRACE_LEVEL_DEBUG 4
+
+#ifndef MYFS_TRACE_LEVEL
+#define MYFS_TRACE_LEVEL 0
+#endif
+
+//Quantidade de eventos mantidos no buffer circular (potencia de 2). Ao
+//encher, os eventos mais antigos sao sobrescritos
+#define TRACE_RING_SIZE 4096
+
+//Operacoes registradas nos eventos binarios
+#define TRACE_OP_MOUNT 1
+#define TRACE_OP_UNMOUNT 2
+#define TRACE_OP_OPEN 3
+#define TRACE_OP_LOOKUP 4
+#define TRACE_OP_DIRADD 5
+#define TRACE_OP_BLOCKALLOC 6
+#define TRACE_OP_BLOCKFREE 7
+#define TRACE_OP_JCOMMIT 8
+#define TRACE_OP_JCHECKPOINT 9
+
+//Evento do buffer circular. E' gravado em disco exatamente neste formato
+typedef struct trace_event {
+	unsigned long long time; //nanossegundos
+	unsigned int op; //TRACE_OP_*
+	unsigned int inode;
+	unsigned int sector;
+	unsigned int pad;
+} TraceEvent;
+
+//Funcao que escreve em stderr uma mensagem de rastreamento no formato de
+//printf. Usada pelas macros TRACE_*; nao deve ser chamada diretamente
+void traceText (int level, const char *fmt, ...);
+
+//Funcao que acrescenta um evento ao buffer circular. Usada pela macro
+//TRACE_EVENT; nao deve ser chamada diretamente
+void traceRingAdd (unsigned int op, unsigned int inode, unsigned int sector);
+
+//Funcao que grava os eventos do buffer circular, do mais antigo para o mais
+//recente, no arquivo path: a palavra "MTRC", a quantidade de eventos e os
+//eventos (TraceEvent). Retorna a quantidade de eventos gravados ou -1 (o
+//que inclui compilacoes sem MYFS_TRACE_RING)
+int traceRingDump (const char *path);
+
+#if MYFS_TRACE_LEVEL >= TRACE_LEVEL_ERROR
+#define TRACE_ERROR(...) traceText(TRACE_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define TRACE_ERROR(...) ((void) 0)
+#endif
+
+#if MYFS_TRACE_LEVEL >= TRACE_LEVEL_WARN
+#define TRACE_WARN(...) traceText(TRACE_LEVEL_WARN, __VA_ARGS__)
+#else
+#define TRACE_WARN(...) ((void) 0)
+#endif
+
+#if MYFS_TRACE_LEVEL >= TRACE_LEVEL_INFO
+#define TRACE_INFO(...) traceText(TRACE_LEVEL_INFO, __VA_ARGS__)
+#else
+#define TRACE_INFO(...) ((void) 0)
+#endif
+
+#if MYFS_TRACE_LEVEL >= TRACE_LEVEL_DEBUG
+#define TRACE_DEBUG(...) traceText(TRACE_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define TRACE_DEBUG(...) ((void) 0)
+#endif
+
+#ifdef MYFS_TRACE_RING
+#define TRACE_EVENT(op, inode, sector) traceRingAdd((op), (inode), (sector))
+#else
+#define TRACE_EVENT(op, inode, sector) ((void) 0)
+#endif
+
+#endif
@@ -6,19 +6,40 @@
 *  Organizacao: Universidade Federal de Juiz de Fora
 *  Departamento: Dep. Ciencia da Computacao
 *
-*  => NAO MODIFIQUE ESTE ARQUIVO <=
+*  Estendido no projeto: acesso por varias threads, leitura e escrita por
+*  posicao e vetoriais, emprestimo de blocos e listagem de diretorios em lote.
 *
 */
 
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
 #include "vfs.h"
 #include "inode.h"
 
 #define MAX_INSTALLED_FS 4
 
+//Sistema de arquivos montado em um ponto da arvore unica
+typedef struct mount {
+	Disk *d;		//NULL: posicao livre
+	FSInfo *fs;
+	char path[MAX_FILENAME_LENGTH+1];	//Ponto de montagem, sem '/' no fim (exceto a raiz)
+	unsigned int pathLen;
+	unsigned int openCount;	//Descritores abertos nesta montagem
+} Mount;
+
+//Descritor do vfs: cada montagem tem os seus proprios descritores, que sao
+//traduzidos a cada chamada
+typedef struct vfsFile {
+	unsigned int mount;	//1 + posicao em mounts (0: descritor livre)
+	int fd;			//Descritor no sistema de arquivos da montagem
+} VfsFile;
+
 FSInfo* installedFSInfo[MAX_INSTALLED_FS];
-Disk* rootDisk;
-FSInfo* rootFS;
+Mount mounts[MAX_MOUNTS];
+VfsFile vfsFiles[MAX_FDS];
+pthread_rwlock_t mountLock = PTHREAD_RWLOCK_INITIALIZER; //Protege mounts e installedFSInfo
+pthread_mutex_t fileLock = PTHREAD_MUTEX_INITIALIZER; //Protege a alocacao de vfsFiles
 
 //Funcao interna para a obtencao do FSInfo correspondente a um fsId
 FSInfo* __vfsGetFSInfo (char fsId) {
@@ -33,33 +54,167 @@ FSInfo* __vfsGetFSInfo (char fsId) {
 	return fsInfo;
 }
 
+//Funcao interna que retorna a montagem de maior prefixo que contem path,
+//ou -1. Em *rest fica o caminho dentro do sistema de arquivos montado
+int __vfsFindMount (const char *path, const char **rest) {
+	int found = -1;
+	if ( !path || path[0] != '/' ) return -1;
+	for (int i = 0; i < MAX_MOUNTS; i++) {
+		unsigned int len = mounts[i].pathLen;
+		if ( !mounts[i].d || strncmp (path, mounts[i].path, len) ) continue;
+		if ( len > 1 && path[len] != '\0' && path[len] != '/' ) continue;
+		if ( found == -1 || len > mounts[found].pathLen ) found = i;
+	}
+	if ( found != -1 ) {
+		*rest = mounts[found].pathLen > 1 ? path + mounts[found].pathLen : path;
+		if ( **rest == '\0' ) *rest = "/";
+	}
+	return found;
+}
+
+//Funcao interna que retorna a entrada aberta do descritor fd do vfs, ou NULL
+VfsFile* __vfsGetFile (int fd) {
+	if ( fd < 1 || fd > MAX_FDS || !vfsFiles[fd-1].mount ) return NULL;
+	return &vfsFiles[fd-1];
+}
+
+//Funcao interna que ocupa um descritor do vfs para o descritor fd da
+//montagem m. Retorna o descritor ou -1 se nao houver descritor livre
+int __vfsAllocFile (int m, int fd) {
+	int ret = -1;
+	pthread_mutex_lock (&fileLock);
+	for (int i = 0; i < MAX_FDS && ret == -1; i++) {
+		if ( vfsFiles[i].mount ) continue;
+		vfsFiles[i].mount = m + 1;
+		vfsFiles[i].fd = fd;
+		mounts[m].openCount++;
+		ret = i + 1;
+	}
+	pthread_mutex_unlock (&fileLock);
+	return ret;
+}
+
+//Funcao interna que devolve o descritor f do vfs
+void __vfsFreeFile (VfsFile *f) {
+	pthread_mutex_lock (&fileLock);
+	mounts[f->mount-1].openCount--;
+	f->mount = 0;
+	pthread_mutex_unlock (&fileLock);
+}
+
+//Funcao interna que abre, com openFn (arquivos) ou opendirFn (diretorios),
+//o caminho path na montagem que o contem. Retorna o descritor do vfs ou -1
+int __vfsOpenPath (const char *path, int dir) {
+	const char *rest;
+	int ret = -1;
+	pthread_rwlock_rdlock (&mountLock);
+	int m = __vfsFindMount (path, &rest);
+	if ( m != -1 ) {
+		FSInfo *fs = mounts[m].fs;
+		int fd = dir ? fs->opendirFn (mounts[m].d, rest) : fs->openFn (mounts[m].d, rest);
+		if ( fd != -1 && (ret = __vfsAllocFile (m, fd)) == -1 ) {
+			if ( dir ) fs->closedirFn (fd);
+			else fs->closeFn (fd);
+		}
+	}
+	pthread_rwlock_unlock (&mountLock);
+	return ret;
+}
+
+//Funcao interna que fecha o descritor fd do vfs com closeFn (arquivos) ou
+//closedirFn (diretorios). Retorna 0 ou -1
+int __vfsClosePath (int fd, int dir) {
+	int ret = -1;
+	pthread_rwlock_rdlock (&mountLock);
+	VfsFile *f = __vfsGetFile (fd);
+	if ( f ) {
+		FSInfo *fs = mounts[f->mount-1].fs;
+		ret = dir ? fs->closedirFn (f->fd) : fs->closeFn (f->fd);
+		if ( ret == 0 ) __vfsFreeFile (f);
+	}
+	pthread_rwlock_unlock (&mountLock);
+	return ret;
+}
+
 //Funcao para inicializacao do sistema de arquivos virtual
 void vfsInit ( void ) {
 	for (int i=0; i<MAX_INSTALLED_FS; i++)
 		installedFSInfo[i] = NULL;
-	rootDisk = NULL;
-	rootFS = NULL;	
+	memset (mounts, 0, sizeof(mounts));
+	memset (vfsFiles, 0, sizeof(vfsFiles));
+}
+
+//Funcao para a montagem do sistema de arquivos fsId do disco d no ponto
+//path da arvore unica. O ponto de montagem e' um prefixo de caminho: nao
+//precisa existir no sistema de arquivos de cima, e cada caminho e' tratado
+//pela montagem de maior prefixo que o contem. Retorna 0 caso bem sucedido
+//e -1 em contrario
+int vfsMount (Disk *d, char fsId, const char *path) {
+	FSInfo *fsInfo = NULL;
+	int ret = -1, free = -1;
+	if ( !d || !path || path[0] != '/' ) return -1;
+	unsigned int len = strlen (path);
+	while ( len > 1 && path[len-1] == '/' ) len--;
+	if ( len > MAX_FILENAME_LENGTH ) return -1;
+
+	pthread_rwlock_wrlock (&mountLock);
+	fsInfo = __vfsGetFSInfo (fsId);
+	for (int i = 0; i < MAX_MOUNTS && fsInfo; i++) {
+		if ( !mounts[i].d ) {
+			if ( free == -1 ) free = i;
+			continue;
+		}
+		//um disco so' e' montado uma vez, e um ponto so' recebe um disco
+		if ( mounts[i].d == d || (mounts[i].pathLen == len && !strncmp (mounts[i].path, path, len)) )
+			fsInfo = NULL;
+	}
+	if ( fsInfo && free != -1 && ( !fsInfo->mountFn || fsInfo->mountFn (d) == 0 ) ) {
+		mounts[free].fs = fsInfo;
+		memcpy (mounts[free].path, path, len);
+		mounts[free].path[len] = '\0';
+		mounts[free].pathLen = len;
+		mounts[free].openCount = 0;
+		mounts[free].d = d;
+		ret = 0;
+	}
+	pthread_rwlock_unlock (&mountLock);
+	return ret;
+}
+
+//Funcao para a desmontagem do sistema de arquivos montado no ponto path.
+//Nao podem haver arquivos ou diretorios abertos nele. Retorna 0 caso bem
+//sucedido e -1 caso contrario
+int vfsUnmount (const char *path) {
+	int ret = -1;
+	if ( !path ) return -1;
+	unsigned int len = strlen (path);
+	while ( len > 1 && path[len-1] == '/' ) len--;
+
+	pthread_rwlock_wrlock (&mountLock);
+	for (int i = 0; i < MAX_MOUNTS; i++) {
+		Mount *m = &mounts[i];
+		if ( !m->d || m->pathLen != len || strncmp (m->path, path, len) ) continue;
+		if ( !m->openCount && ( !m->fs->unmountFn || m->fs->unmountFn (m->d) == 0 ) ) {
+			m->d = NULL;
+			ret = 0;
+		}
+		break;
+	}
+	pthread_rwlock_unlock (&mountLock);
+	return ret;
 }
 
 //Funcao para a montagem do sistema de arquivos que sera' a raiz da arvore
 //unica do sistema (Unix-like). Retorna 0 caso bem sucedido e -1 em contrario
 int vfsMountRoot (Disk *d, char fsId) {
-	if ( !d ) return -1;
-	rootFS = __vfsGetFSInfo (fsId);
-	if ( !rootFS ) return -1;
-	rootDisk = d;
-	return 0;
+	return vfsMount (d, fsId, "/");
 }
 
 //Funcao para a desmontagem do sistema de arquivos. Nao podem haver arquivos
 //ou diretorios abertos para a desmontagem. Retorna 0 caso bem sucedido e -1
 //caso contrario
 int vfsUnmountRoot ( void ) {
-	if ( !rootDisk || !rootFS ) return -1;
-	if ( !rootFS->isidleFn (rootDisk) ) return -1;
-	rootFS = NULL;
-	rootDisk = NULL;
-	return 0;
+	return vfsUnmount ("/");
 }
 
 //Funcao para formatacao de um disco com o sistema de arquivos indicado pelo
@@ -68,10 +223,15 @@ int vfsUnmountRoot ( void ) {
 //formatado com sucesso. Caso contrario, retorna -1.
 int vfsFormat (Disk *d, unsigned int blockSize, char fsId) {
 	FSInfo *fsInfo = NULL;
+	int ret = -1;
 	if ( !d ) return -1;
+	pthread_rwlock_rdlock (&mountLock);
 	fsInfo = __vfsGetFSInfo (fsId);
-	if ( !fsInfo ) return -1;
-	return fsInfo->formatFn(d, blockSize);
+	for (int i = 0; i < MAX_MOUNTS; i++)
+		if ( mounts[i].d == d ) fsInfo = NULL; //disco montado
+	if ( fsInfo ) ret = fsInfo->formatFn(d, blockSize);
+	pthread_rwlock_unlock (&mountLock);
+	return ret;
 }
 
 //Funcao para abertura de um arquivo, a partir do caminho especificado em path,
@@ -79,8 +239,7 @@ int vfsFormat (Disk *d, unsigned int blockSize, char fsId) {
 //arquivo, em caso de sucesso. Retorna -1, caso contrario.
 //Descritores de arquivo se iniciam em 1
 int vfsOpen (const char *path) {
-	if ( !rootDisk || !rootFS ) return -1;
-	return rootFS->openFn (rootDisk, path);
+	return __vfsOpenPath (path, 0);
 }
 
 //Funcao para a leitura de um arquivo, a partir de um descritor de arquivo
@@ -88,8 +247,12 @@ int vfsOpen (const char *path) {
 //nbytes. Retorna o numero de bytes efetivamente lidos em caso de sucesso ou
 //-1, caso contrario.
 int vfsRead (int fd, char *buf, unsigned int nbytes) {
-	if ( !rootDisk || !rootFS ) return -1;
-	return rootFS->readFn (fd, buf, nbytes);
+	int ret = -1;
+	pthread_rwlock_rdlock (&mountLock);
+	VfsFile *f = __vfsGetFile (fd);
+	if ( f ) ret = mounts[f->mount-1].fs->readFn (f->fd, buf, nbytes);
+	pthread_rwlock_unlock (&mountLock);
+	return ret;
 }
 
 //Funcao para a escrita de um arquivo, a partir de um descritor de arquivo
@@ -97,23 +260,132 @@ int vfsRead (int fd, char *buf, unsigned int nbytes) {
 //maximo de nbytes. Retorna o numero de bytes efetivamente escritos em caso
 //de sucesso ou -1, caso contrario
 int vfsWrite (int fd, const char *buf, unsigned int nbytes) {
-        if ( !rootDisk || !rootFS ) return -1;
-        return rootFS->writeFn (fd, buf, nbytes);
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f ) ret = mounts[f->mount-1].fs->writeFn (f->fd, buf, nbytes);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
+}
+
+//Funcao para a leitura de um arquivo a partir da posicao offset, sem usar
+//nem alterar o cursor do descritor. Retorna o numero de bytes efetivamente
+//lidos em caso de sucesso ou -1, caso contrario.
+int vfsPread (int fd, char *buf, unsigned int nbytes, unsigned int offset) {
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f && mounts[f->mount-1].fs->preadFn )
+                ret = mounts[f->mount-1].fs->preadFn (f->fd, buf, nbytes, offset);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
+}
+
+//Funcao para a escrita de um arquivo a partir da posicao offset, sem usar
+//nem alterar o cursor do descritor. Retorna o numero de bytes efetivamente
+//escritos em caso de sucesso ou -1, caso contrario.
+int vfsPwrite (int fd, const char *buf, unsigned int nbytes, unsigned int offset) {
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f && mounts[f->mount-1].fs->pwriteFn )
+                ret = mounts[f->mount-1].fs->pwriteFn (f->fd, buf, nbytes, offset);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
+}
+
+//Funcao interna que le (ou escreve, se write) a sequencia de buffers iov
+//um buffer por vez, para sistemas de arquivos sem readvFn ou writevFn
+int __vfsRwv (FSInfo *fs, int fd, const VfsIovec *iov, int iovcnt, int write) {
+        int total = 0;
+        if ( !iov || iovcnt < 1 ) return -1;
+        for (int i = 0; i < iovcnt; i++) {
+                int n = write ? fs->writeFn (fd, iov[i].base, iov[i].len) : fs->readFn (fd, iov[i].base, iov[i].len);
+                if ( n == -1 ) return total ? total : -1;
+                total += n;
+                if ( (unsigned int) n < iov[i].len ) break;
+        }
+        return total;
+}
+
+//Funcao para a leitura de um arquivo, a partir do cursor, para a sequencia
+//de iovcnt buffers iov, em ordem. Retorna o numero de bytes efetivamente
+//lidos em caso de sucesso ou -1, caso contrario.
+int vfsReadv (int fd, const VfsIovec *iov, int iovcnt) {
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f ) {
+                FSInfo *fs = mounts[f->mount-1].fs;
+                ret = fs->readvFn ? fs->readvFn (f->fd, iov, iovcnt) : __vfsRwv (fs, f->fd, iov, iovcnt, 0);
+        }
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
+}
+
+//Funcao para a escrita de um arquivo, a partir do cursor, da sequencia de
+//iovcnt buffers iov, em ordem. Retorna o numero de bytes efetivamente
+//escritos em caso de sucesso ou -1, caso contrario.
+int vfsWritev (int fd, const VfsIovec *iov, int iovcnt) {
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f ) {
+                FSInfo *fs = mounts[f->mount-1].fs;
+                ret = fs->writevFn ? fs->writevFn (f->fd, iov, iovcnt) : __vfsRwv (fs, f->fd, iov, iovcnt, 1);
+        }
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
+}
+
+//Funcao para a leitura sem copia de um arquivo a partir da posicao offset.
+//Retorna o numero de bytes disponiveis em *data, 0 no fim do arquivo ou -1
+int vfsBorrow (int fd, unsigned int offset, const char **data) {
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f && mounts[f->mount-1].fs->borrowFn )
+                ret = mounts[f->mount-1].fs->borrowFn (f->fd, offset, data);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
+}
+
+//Funcao que devolve os dados data obtidos por vfsBorrow. Retorna 0 caso bem
+//sucedido, ou -1 caso contrario
+int vfsRelease (int fd, const char *data) {
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f && mounts[f->mount-1].fs->releaseFn )
+                ret = mounts[f->mount-1].fs->releaseFn (f->fd, data);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
+}
+
+//Funcao que posiciona o cursor de um arquivo aberto em offset bytes a partir
+//de whence (VFS_SEEK_SET, VFS_SEEK_CUR ou VFS_SEEK_END). Retorna a nova
+//posicao ou -1, caso contrario.
+int vfsSeek (int fd, long offset, int whence) {
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f && mounts[f->mount-1].fs->seekFn )
+                ret = mounts[f->mount-1].fs->seekFn (f->fd, offset, whence);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
 }
 
 //Funcao para fechar um arquivo, a partir de um descritor de arquivo existente.
 //Retorna 0 caso bem sucedido, ou -1 caso contrario
 int vfsClose (int fd) {
-        if ( !rootDisk || !rootFS ) return -1;
-        return rootFS->closeFn (fd);
+        return __vfsClosePath (fd, 0);
 }
 
 //Funcao para abertura de um diretorio, a partir do caminho especificado em
 //path, no modo Read/Write, criando o diretorio se nao existir. Retorna um
 //descritor de arquivo, em caso de sucesso. Retorna -1, caso contrario.
 int vfsOpendir (const char *path) {
-        if ( !rootDisk || !rootFS ) return -1;
-        return rootFS->opendirFn (rootDisk, path);
+        return __vfsOpenPath (path, 1);
 }
 
 //Funcao para a leitura de um diretorio, identificado por um descritor de
@@ -123,8 +395,38 @@ int vfsOpendir (const char *path) {
 //correspondente 'a entrada e' copiado para inumber. Retorna 1 se uma entrada
 //foi lida, 0 se fim do diretorio ou -1 caso mal sucedido.
 int vfsReaddir (int fd, char *filename, unsigned int *inumber) {
-        if ( !rootDisk || !rootFS ) return -1;
-        return rootFS->readdirFn (fd, filename, inumber);
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f ) ret = mounts[f->mount-1].fs->readdirFn (f->fd, filename, inumber);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
+}
+
+//Funcao para a leitura de um lote de entradas de um diretorio aberto, a
+//partir da posicao *cookie. Retorna os bytes copiados para buf, 0 no fim do
+//diretorio ou -1 caso mal sucedido
+int vfsGetdents (int fd, char *buf, unsigned int nbytes, unsigned int *cookie) {
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f && mounts[f->mount-1].fs->getdentsFn )
+                ret = mounts[f->mount-1].fs->getdentsFn (f->fd, buf, nbytes, cookie);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
+}
+
+//Funcao para a leitura de ate max entradas de um diretorio aberto, com os
+//atributos dos seus i-nodes, a partir da posicao *cookie. Retorna a
+//quantidade de entradas, 0 no fim do diretorio ou -1 caso mal sucedido
+int vfsReaddirPlus (int fd, VfsDirentPlus *entries, unsigned int max, unsigned int *cookie) {
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f && mounts[f->mount-1].fs->readdirplusFn )
+                ret = mounts[f->mount-1].fs->readdirplusFn (f->fd, entries, max, cookie);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
 }
 
 //Funcao para adicionar uma entrada a um diretorio, identificado por um 
@@ -132,52 +434,67 @@ int vfsReaddir (int fd, char *filename, unsigned int *inumber) {
 //filename e apontara' para o numero de i-node indicado por inumber. Retorna 0\
 //caso bem sucedido, ou -1 caso contrario.
 int vfsLink (int fd, const char *filename, unsigned int inumber) {
-        if ( !rootDisk || !rootFS ) return -1;
-        return rootFS->linkFn (fd, filename, inumber);
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f ) ret = mounts[f->mount-1].fs->linkFn (f->fd, filename, inumber);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
 }
 
 //Funcao para remover uma entrada existente em um diretorio, este identificado
 //por um descritor de arquivo existente. A entrada e' identificada pelo nome 
 //indicado em filename. Retorna 0 caso bem sucedido, ou -1 caso contrario.
 int vfsUnlink (int fd, const char *filename) {
-        if ( !rootDisk || !rootFS ) return -1;
-        return rootFS->unlinkFn (fd, filename);
+        int ret = -1;
+        pthread_rwlock_rdlock (&mountLock);
+        VfsFile *f = __vfsGetFile (fd);
+        if ( f ) ret = mounts[f->mount-1].fs->unlinkFn (f->fd, filename);
+        pthread_rwlock_unlock (&mountLock);
+        return ret;
 }
 
 //Funcao para fechar um diretorio, identificado por um descritor de arquivo
 //existente. Retorna 0 caso bem sucedido, ou -1 caso contrario.
 int vfsClosedir (int fd) {
-        if ( !rootDisk || !rootFS ) return -1;
-        return rootFS->closedirFn (fd);
+        return __vfsClosePath (fd, 1);
 }
 
 //Registra novo sistema de arquivos. Retorna um identificador unico (slot),
 //caso o sistema de arquivos tenha sido registrado com sucesso. Caso contrario,
 //retorna -1
 int vfsRegisterFS (FSInfo* fsInfo) {
-	int i;
+	int i, ret = -1;
 	if ( !fsInfo ) return -1;
+	pthread_rwlock_wrlock (&mountLock);
 	for (i=MAX_INSTALLED_FS; i>0; i--)
 	if ( !installedFSInfo[i-1] ) {
 		installedFSInfo[i-1] = fsInfo;
-			return 0;
+			ret = 0;
+			break;
 		}
-	return -1;
+	pthread_rwlock_unlock (&mountLock);
+	return ret;
 }
 
 //Desfaz o registro de um sistema de arquivos. Um sistema de arquivos montado
 //nao pode ter seu registro desfeito. Retorna 0 se bem sucedido e -1 caso
 //contrario
 int vfsUnregisterFS(char fsId) {
-	if (fsId == rootFS->fsid) return -1;
-	for (int i=0; i<MAX_INSTALLED_FS; i++) {
+	int ret = -1;
+	pthread_rwlock_wrlock (&mountLock);
+	for (int i=0; i<MAX_MOUNTS; i++)
+		if ( mounts[i].d && fsId == mounts[i].fs->fsid ) fsId = 0; //montado
+	for (int i=0; i<MAX_INSTALLED_FS && fsId; i++) {
 		if ( !installedFSInfo[i] ) continue;
 		if ( fsId == installedFSInfo[i]->fsid ) {
 			installedFSInfo[i] = NULL;
-			return 0;
+			ret = 0;
+			break;
 		}
 	}
-	return -1;
+	pthread_rwlock_unlock (&mountLock);
+	return ret;
 }
 
 //Escreve na saida padrao as informacoes sobre sistemas de arquivos registrados
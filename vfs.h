@@ -6,7 +6,8 @@
 *  Organizacao: Universidade Federal de Juiz de Fora
 *  Departamento: Dep. Ciencia da Computacao
 *
-*  => NAO MODIFIQUE ESTE ARQUIVO <=
+*  Estendido no projeto: acesso por varias threads, leitura e escrita por
+*  posicao e vetoriais, emprestimo de blocos e listagem de diretorios em lote.
 *
 */
 
@@ -21,6 +22,39 @@
 #define FILETYPE_DIR 128    //Identificador de tipo de arquivo: diretorio
 #define FILETYPE_REGULAR 64 //Identificador de tipo de arquivo: arq regular
 
+#define VFS_SEEK_SET 0 //Referencia de deslocamento: inicio do arquivo
+#define VFS_SEEK_CUR 1 //Referencia de deslocamento: posicao atual
+#define VFS_SEEK_END 2 //Referencia de deslocamento: fim do arquivo
+
+//Registro de uma entrada de diretorio copiada por vfsGetdents. Os registros
+//ficam em sequencia no buffer, cada um com recLen bytes (alinhado em 4)
+typedef struct vfs_dirent {
+	unsigned int inumber;	//Numero do i-node da entrada
+	unsigned short recLen;	//Tamanho do registro, em bytes
+	unsigned char nameLen;	//Tamanho do nome, sem o \0
+	unsigned char type;	//FILETYPE_DIR ou FILETYPE_REGULAR
+	char name[];		//Nome, terminado em \0
+} VfsDirent;
+
+#define VFS_DIRENT_SIZE(nameLen) ((sizeof(VfsDirent) + (nameLen) + 1 + 3) & ~3u)
+
+//Entrada de diretorio com os atributos do seu i-node, lida por
+//vfsReaddirPlus
+typedef struct vfs_dirent_plus {
+	unsigned int inumber;	//Numero do i-node da entrada
+	unsigned int type;	//FILETYPE_DIR ou FILETYPE_REGULAR
+	unsigned int size;	//Tamanho do arquivo, em bytes
+	unsigned int owner;	//Proprietario
+	unsigned int permission;	//Permissao
+	char name[MAX_FILENAME_LENGTH+1];	//Nome, terminado em \0
+} VfsDirentPlus;
+
+//Buffer de uma leitura ou escrita vetorial (vfsReadv e vfsWritev)
+typedef struct vfs_iovec {
+	void *base;		//Inicio do buffer
+	unsigned int len;	//Tamanho do buffer em bytes
+} VfsIovec;
+
 //Estrutura para definicao da API de sistemas de arquivos.
 //Deve ser preenchida com os ponteiros das respectivas funcoes e passada
 //para registro por meio da funcao vfsRegister()
@@ -92,11 +126,84 @@ typedef struct fs_info {
 	//arquivo existente. Retorna 0 caso bem sucedido, ou -1 caso contrario.	
 	int (*closedirFn) (int fd);
 
+	//Funcao opcional (pode ser NULL) chamada na montagem do disco d. Le do
+	//disco apenas o necessario para atender as operacoes seguintes.
+	//Retorna 0 caso bem sucedido, ou -1 caso contrario.
+	int (*mountFn) (Disk *d);
+
+	//Funcao opcional (pode ser NULL) chamada na desmontagem do disco d,
+	//quando o sistema de arquivos esta' ocioso. Grava o estado pendente e
+	//marca o disco como desmontado corretamente. Retorna 0 caso bem
+	//sucedido, ou -1 caso contrario.
+	int (*unmountFn) (Disk *d);
+
+	//Funcoes opcionais (podem ser NULL) para a leitura e a escrita de um
+	//arquivo a partir da posicao offset, sem usar nem alterar o cursor do
+	//descritor, de modo que varias threads possam usar o mesmo descritor
+	//ao mesmo tempo. Retornam o numero de bytes efetivamente lidos ou
+	//escritos em caso de sucesso ou -1, caso contrario.
+	int (*preadFn) (int fd, char *buf, unsigned int nbytes, unsigned int offset);
+	int (*pwriteFn) (int fd, const char *buf, unsigned int nbytes, unsigned int offset);
+
+	//Funcao opcional (pode ser NULL) que posiciona o cursor de um arquivo
+	//aberto em offset bytes a partir da referencia whence (VFS_SEEK_SET,
+	//VFS_SEEK_CUR ou VFS_SEEK_END). Retorna a nova posicao ou -1, caso
+	//contrario.
+	int (*seekFn) (int fd, long offset, int whence);
+
+	//Funcoes opcionais (podem ser NULL) para a leitura e a escrita de um
+	//arquivo, a partir do cursor, para (ou de) uma sequencia de iovcnt
+	//buffers iov, em ordem, mapeando os blocos uma unica vez. Retornam o
+	//numero de bytes efetivamente lidos ou escritos em caso de sucesso ou
+	//-1, caso contrario.
+	int (*readvFn) (int fd, const VfsIovec *iov, int iovcnt);
+	int (*writevFn) (int fd, const VfsIovec *iov, int iovcnt);
+
+	//Funcoes opcionais (podem ser NULL) para a leitura sem copia: borrowFn
+	//faz *data apontar, somente para leitura, para os dados do arquivo a
+	//partir da posicao offset, mantidos pelo sistema de arquivos ate a
+	//chamada de releaseFn com o mesmo ponteiro. borrowFn retorna o numero
+	//de bytes disponiveis em *data (0 no fim do arquivo) e releaseFn
+	//retorna 0; ambas retornam -1 caso mal sucedidas.
+	int (*borrowFn) (int fd, unsigned int offset, const char **data);
+	int (*releaseFn) (int fd, const char *data);
+
+	//Funcao opcional (pode ser NULL) para a leitura de um lote de entradas
+	//de um diretorio, identificado por um descritor de arquivo existente,
+	//a partir da posicao *cookie (0 no inicio), sem usar o cursor. Copia
+	//para buf tantos registros VfsDirent quantos couberem em nbytes e faz
+	//*cookie indicar o inicio do proximo lote. Retorna os bytes copiados,
+	//0 no fim do diretorio ou -1 caso mal sucedido.
+	int (*getdentsFn) (int fd, char *buf, unsigned int nbytes, unsigned int *cookie);
+
+	//Funcao opcional (pode ser NULL) para a leitura de ate max entradas de
+	//um diretorio aberto, a partir da posicao *cookie (0 no inicio), junto
+	//com os atributos dos seus i-nodes (tipo, tamanho, proprietario e
+	//permissao). Faz *cookie indicar o inicio do proximo lote. Retorna a
+	//quantidade de entradas, 0 no fim do diretorio ou -1 caso mal sucedido.
+	int (*readdirplusFn) (int fd, VfsDirentPlus *entries, unsigned int max, unsigned int *cookie);
+
 } FSInfo;
 
 //Funcao para inicializacao do sistema de arquivos virtual
 void vfsInit ( void );
 
+//Quantidade maxima de sistemas de arquivos montados ao mesmo tempo
+#define MAX_MOUNTS 8
+
+//Funcao para a montagem do sistema de arquivos fsId do disco d no ponto
+//path da arvore unica (ex.: "/dados"). Cada caminho e' tratado pela
+//montagem de maior prefixo que o contem, e cada montagem tem os seus
+//descritores. Um disco so' pode ser montado uma vez, e o sistema de
+//arquivos pode recusar a montagem (o MyFS monta um disco por vez).
+//Retorna 0 caso bem sucedido e -1 em contrario
+int vfsMount (Disk *d, char fsId, const char *path);
+
+//Funcao para a desmontagem do sistema de arquivos montado no ponto path.
+//Nao podem haver arquivos ou diretorios abertos nele. Retorna 0 caso bem
+//sucedido e -1 caso contrario
+int vfsUnmount (const char *path);
+
 //Funcao para a montagem do sistema de arquivos que sera' a raiz da arvore
 //unica do sistema (Unix-like). Retorna 0 caso bem sucedido e -1 em contrario
 int vfsMountRoot (Disk *d, char fsId);
@@ -129,6 +236,36 @@ int vfsRead (int fd, char *buf, unsigned int nbytes);
 //de sucesso ou -1, caso contrario
 int vfsWrite (int fd, const char *buf, unsigned int nbytes);
 
+//Funcoes para a leitura e a escrita de um arquivo a partir da posicao
+//offset, sem usar nem alterar o cursor do descritor: varias threads podem
+//usar o mesmo descritor ao mesmo tempo. Retornam o numero de bytes
+//efetivamente lidos ou escritos em caso de sucesso ou -1, caso contrario
+int vfsPread (int fd, char *buf, unsigned int nbytes, unsigned int offset);
+int vfsPwrite (int fd, const char *buf, unsigned int nbytes, unsigned int offset);
+
+//Funcoes para a leitura e a escrita de um arquivo, a partir do cursor,
+//para (ou de) uma sequencia de iovcnt buffers iov, em ordem. Retornam o
+//numero de bytes efetivamente lidos ou escritos em caso de sucesso ou -1,
+//caso contrario
+int vfsReadv (int fd, const VfsIovec *iov, int iovcnt);
+int vfsWritev (int fd, const VfsIovec *iov, int iovcnt);
+
+//Funcao para a leitura sem copia de um arquivo a partir da posicao offset:
+//*data aponta, somente para leitura, para os dados, que continuam validos
+//ate vfsRelease. O cursor nao muda. Retorna o numero de bytes disponiveis
+//em *data (que pode ser menor que o resto do arquivo), 0 no fim do arquivo
+//ou -1, caso contrario
+int vfsBorrow (int fd, unsigned int offset, const char **data);
+
+//Funcao que devolve os dados data obtidos por vfsBorrow, antes de fechar o
+//descritor fd. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int vfsRelease (int fd, const char *data);
+
+//Funcao que posiciona o cursor de um arquivo aberto em offset bytes a partir
+//de whence (VFS_SEEK_SET, VFS_SEEK_CUR ou VFS_SEEK_END). Retorna a nova
+//posicao ou -1, caso contrario
+int vfsSeek (int fd, long offset, int whence);
+
 //Funcao para fechar um arquivo, a partir de um descritor de arquivo existente.
 //Retorna 0 caso bem sucedido, ou -1 caso contrario
 int vfsClose (int fd);
@@ -146,6 +283,19 @@ int vfsOpendir (const char *path);
 //foi lida, 0 se fim de diretorio ou -1 caso mal sucedido
 int vfsReaddir (int fd, char *filename, unsigned int *inumber);
 
+//Funcao para a leitura de um lote de entradas de um diretorio aberto, a partir
+//da posicao *cookie (0 no inicio). Copia para buf tantos registros VfsDirent
+//quantos couberem em nbytes e faz *cookie indicar o inicio do proximo lote.
+//Retorna os bytes copiados, 0 no fim do diretorio ou -1 caso mal sucedido
+int vfsGetdents (int fd, char *buf, unsigned int nbytes, unsigned int *cookie);
+
+//Funcao para a leitura de ate max entradas de um diretorio aberto, a partir
+//da posicao *cookie (0 no inicio), junto com o tipo, o tamanho, o
+//proprietario e a permissao de cada uma. Faz *cookie indicar o inicio do
+//proximo lote. Retorna a quantidade de entradas, 0 no fim do diretorio ou -1
+//caso mal sucedido
+int vfsReaddirPlus (int fd, VfsDirentPlus *entries, unsigned int max, unsigned int *cookie);
+
 //Funcao para adicionar uma entrada a um diretorio, identificado por um 
 //descritor de arquivo existente. A nova entrada tera' o nome indicado por
 //filename e apontara' para o numero de i-node indicado por inumber. Retorna 0